@@ -0,0 +1,147 @@
+// bench.c - headless benchmark harness for kilo's core paths. Built by
+// `make bench`; run ./bench for a table or ./bench --json for output a
+// CI job can diff. KILO_BENCH_SCALE multiplies every workload size (the
+// default keeps a run under a few seconds; scale up for the big-corpus
+// find numbers).
+#define main kilo_main
+#include "kilo.c"
+#undef main
+
+#include <sys/resource.h>
+
+// benchNow: Monotonic clock in nanoseconds
+static long long benchNow(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// benchPeakRss: Process peak RSS in kilobytes (cumulative across scenarios)
+static long benchPeakRss(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss;
+}
+
+// benchReset: Drop all editor state so scenarios don't see each other
+static void benchReset(void) {
+    for (int i = 0; i < E.numrows; i++) editorFreeRow(editorRowAt(i));
+    free(E.row);
+    E.row = NULL;
+    E.rowcap = 0;
+    E.row_gap = 0;
+    E.numrows = 0;
+    E.cx = E.cy = E.rowoff = E.coloff = 0;
+    E.dirty_flag = 0;
+    editorShadowResize(E.screenrows + 2);
+}
+
+// benchFillRows: Load 'n' synthetic rows of varied width and content
+static void benchFillRows(int n) {
+    char line[128];
+    for (int i = 0; i < n; i++) {
+        int len = snprintf(line, sizeof(line),
+                           "line %d\tpadding padding padding %08x", i, i * 2654435761u);
+        editorInsertRow(E.numrows, line, len);
+    }
+}
+
+static int json_mode = 0;
+static int results_emitted = 0;
+
+// benchReport: Print one scenario's numbers in the selected format
+static void benchReport(const char *name, long long ns, long ops) {
+    if (json_mode) {
+        printf("%s\n  {\"name\": \"%s\", \"ns_per_op\": %.1f, \"ops\": %ld, \"peak_rss_kb\": %ld}",
+               results_emitted ? "," : "", name, (double)ns / ops, ops, benchPeakRss());
+    } else {
+        printf("%-16s %10.1f ns/op %12ld ops   peak rss %ld KB\n",
+               name, (double)ns / ops, ops, benchPeakRss());
+    }
+    results_emitted++;
+}
+
+// benchInsertRows: Bulk load through editorInsertRow
+static void benchInsertRows(int scale) {
+    benchReset();
+    long n = 200000L * scale;
+    char line[128];
+    long long t0 = benchNow();
+    for (long i = 0; i < n; i++) {
+        int len = snprintf(line, sizeof(line), "row %ld of the corpus", i);
+        editorInsertRow(E.numrows, line, len);
+    }
+    benchReport("insert_rows", benchNow() - t0, n);
+}
+
+// benchEditStorm: Alternating mid-row insert/delete across the file
+static void benchEditStorm(int scale) {
+    benchReset();
+    benchFillRows(2000);
+    long n = 200000L * scale;
+    long long t0 = benchNow();
+    for (long i = 0; i < n; i++) {
+        erow *row = editorRowAt((int)(i * 7919 % E.numrows));
+        int at = row -> size / 2;
+        if (i & 1)
+            editorRowDelChar(row, at);
+        else
+            editorRowInsertChar(row, at, 'x');
+    }
+    benchReport("edit_storm", benchNow() - t0, n);
+}
+
+// benchFind: Repeated match-list builds, including the narrowing path
+static void benchFind(int scale) {
+    benchReset();
+    benchFillRows(50000 * scale);
+    long n = 0;
+    long long t0 = benchNow();
+    for (int rep = 0; rep < 20; rep++) {
+        // Fresh query, then two extensions that narrow the existing list
+        editorSearchBuild("padd");
+        editorSearchBuild("paddi");
+        editorSearchBuild("padding p");
+        editorSearchFree();
+        n += 3;
+    }
+    benchReport("find", benchNow() - t0, n);
+}
+
+// benchDrawFrame: Frame assembly into an abuf while scrolling one row
+// per frame, so the damage tracker does incremental work each time
+static void benchDrawFrame(int scale) {
+    benchReset();
+    benchFillRows(10000);
+    long n = 50000L * scale;
+    struct abuf ab = ABUF_INIT;
+    long long t0 = benchNow();
+    for (long i = 0; i < n; i++) {
+        E.rowoff = (int)(i % (E.numrows - E.screenrows));
+        ab.len = 0;
+        editorDrawRows(&ab);
+    }
+    benchReport("draw_frame", benchNow() - t0, n);
+    abFree(&ab);
+}
+
+int main(int argc, char *argv[]) {
+    json_mode = (argc > 1 && strcmp(argv[1], "--json") == 0);
+    int scale = 1;
+    char *s = getenv("KILO_BENCH_SCALE");
+    if (s && atoi(s) > 0) scale = atoi(s);
+
+    // Headless: no terminal, just a fixed frame size
+    E.screenrows = 40;
+    E.screencols = 120;
+    E.filename = NULL;
+    E.syntax = NULL;
+
+    if (json_mode) printf("{\"scale\": %d, \"bench\": [", scale);
+    benchInsertRows(scale);
+    benchEditStorm(scale);
+    benchFind(scale);
+    benchDrawFrame(scale);
+    if (json_mode) printf("\n]}\n");
+    return 0;
+}
@@ -1,806 +1,4052 @@
-// kilo.c - A small, simple text editor in C
-// Inspired by kilo by Salvatore Sanfilippo (antirez)
-// Follows the tutorial by Jeremy Ruten (snaptoken)
-// This file implements a terminal-based text editor with basic features:
-
-// * INCLUDES ----------
-#define _DEFAULT_SOURCE
-#define _BSD_SOURCE
-#define _GNU_SOURCE
-
-#include <ctype.h>
-#include <errno.h>
-#include <fcntl.h>
-#include <stdio.h>
-#include <stdarg.h>
-#include <stdlib.h>
-#include <string.h>
-#include <sys/ioctl.h>
-#include <sys/types.h>
-#include <termios.h>
-#include <time.h>
-#include <unistd.h>
-
-// * DEFINES ---------
-// KILO_VERSION: Editor version string
-#define KILO_VERSION "0.0.1"
-// KILO_TAB_STOP: Number of spaces per tab
-#define KILO_TAB_STOP 8 
-// KILO_QUIT_TIMES: Times to press Ctrl-Q to quit with unsaved changes
-#define KILO_QUIT_TIMES 3
-// CTRL_KEY: Macro to get control-key value
-#define CTRL_KEY(k) ((k) & 0x1f)
-
-// editorKey: Enum for special key codes (arrows, delete, etc.)
-enum editorKey {
-    BACKSPACE = 127,
-    ARROW_LEFT = 1000,
-    ARROW_RIGHT,
-    ARROW_UP,
-    ARROW_DOWN,
-    DEL_KEY,
-    HOME_KEY,
-    END_KEY,
-    PAGE_UP,
-    PAGE_DOWN
-};
-
-// * DATA ----------
-// erow: Structure for a single line of text (with rendered version for tabs)
-typedef struct erow {
-    int size;
-    int rsize;
-    char *chars;
-    char *render;
-} erow;
-
-// editorConfig: Main editor state/configuration
-struct editorConfig {
-    int cx, cy;
-    int rx;
-    int rowoff;
-    int coloff;
-    int screenrows;
-    int screencols;
-    int numrows;
-    erow *row;
-    int dirty_flag;
-    char *filename;
-    char statusmsg[80];
-    time_t status_time;
-    struct termios orig_termios;
-};
-struct editorConfig E;
-
-// * PROTOTYPES ----------
-// Function declarations for status, screen refresh, and prompt
-void editorSetStatusMessage(const char *fmt, ...);
-void editorRefreshScreen();
-char *editorPrompt(char *prompt, void (*callback)(char *, int));
-
-
-// * TERMINAL ----------
-// die: Exit with error, clear screen
-void die(const char *s) {
-    write(STDOUT_FILENO, "\x1b[2J", 4);
-    write(STDOUT_FILENO, "\x1b[H", 3);
-    
-    perror(s);
-    exit(1);
-}
-
-// disableRawMode: Restore terminal to original mode
-void disableRawMode() {
-    if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &E.orig_termios) == -1)
-        die("tcsetattr");
-}
-
-// enableRawMode: Set terminal to raw mode for direct input
-void enableRawMode() {
-    if (tcgetattr(STDIN_FILENO, &E.orig_termios) == -1) die("tcgetattr");
-    atexit(disableRawMode);
-    
-    struct termios raw = E.orig_termios;
-    raw.c_iflag &= ~(BRKINT | ICRNL | INPCK | ISTRIP | IXON);
-    raw.c_oflag &= ~(OPOST);
-    raw.c_cflag |= (CS8);
-    raw.c_lflag &= ~(ECHO | ICANON | IEXTEN | ISIG);
-    
-    raw.c_cc[VMIN] = 0;
-    raw.c_cc[VTIME] = 1;
-
-    if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) == -1) die("tcsetattr");
-}
-
-// editorReadKey: Read a keypress, handle escape sequences for special keys
-int editorReadKey() {
-    int nread;
-    char c;
-    while ((nread = read(STDIN_FILENO, &c, 1)) != 1) {
-        if (nread == -1 && errno != EAGAIN) die("read");
-    }
-    if (c == '\x1b') {
-        // Handle escape sequences for special keys (arrows, home, end, etc.)
-        char seq[3];
-        if (read(STDIN_FILENO, &seq[0], 1) != 1) return '\x1b';
-        if (read(STDIN_FILENO, &seq[1], 1) != 1) return '\x1b';
-        if (seq[0] == '[') {
-            // CSI sequences: ESC [ ...
-            if (seq[1] >= '0' && seq[1] <= '9') {
-                // Extended escape sequence: ESC [ <num> ~
-                if (read(STDIN_FILENO, &seq[2], 1) != 1) return '\x1b';
-                if (seq[2] == '~') {
-                    switch (seq[1]) {
-                        case '1': return HOME_KEY;
-                        case '3': return DEL_KEY;
-                        case '4': return END_KEY;
-                        case '5': return PAGE_UP;
-                        case '6': return PAGE_DOWN;
-                        case '7': return HOME_KEY;
-                        case '8': return END_KEY;
-                    }
-                }
-            } else {
-                // Simple arrow/home/end: ESC [ A/B/C/D/H/F
-                switch (seq[1]) {
-                    case 'A': return ARROW_UP;
-                    case 'B': return ARROW_DOWN;
-                    case 'C': return ARROW_RIGHT;
-                    case 'D': return ARROW_LEFT;
-                    case 'H': return HOME_KEY;
-                    case 'F': return END_KEY;
-                }
-            }
-        } else if (seq[0] == 'O') {
-            // ESC O H/F (alternative home/end)
-            switch (seq[1]) {
-                case 'H': return HOME_KEY;
-                case 'F': return END_KEY;
-            }
-        }
-        return '\x1b'; // Unrecognized escape sequence
-    } else {
-        return c; // Normal character
-    }
-}
-
-// getCursorPosition: Query terminal for cursor position
-int getCursorPosition(int *rows, int *cols) {
-    char buf[32];
-    unsigned int i = 0;
-    // Request cursor position report
-    if (write(STDOUT_FILENO, "\x1b[6n", 4) != 4) return -1;
-    // Read response: ESC [ rows ; cols R
-    while (i < sizeof(buf) - 1) {
-        if (read(STDIN_FILENO, &buf[i], 1) != 1) break;
-        if (buf[i] == 'R') break;
-        i++;
-    }
-    buf[i] = '\0';
-    // Parse response
-    if (buf[0] != '\x1b' || buf[1] != '[') return -1;
-    if (sscanf(&buf[2], "%d;%d", rows, cols) != 2) return -1;
-    return 0;
-}
-
-// getWindowSize: Get terminal window size (rows, cols)
-int getWindowSize(int *rows, int *cols) {
-    struct winsize ws;
-    // Try ioctl first
-    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == -1 || ws.ws_col == 0) {
-        // Fallback: move cursor to bottom-right and query position
-        if (write(STDOUT_FILENO, "\x1b[999C\x1b[999B", 12) != 12) return -1;
-        return getCursorPosition(rows, cols);
-    } else {
-        *cols = ws.ws_col;
-        *rows = ws.ws_row;
-        return 0;
-    }
-}
-
-// * ROW OPERATIONS ----------
-// Functions to manipulate lines (rows): insert, delete, update, etc.
-
-int editorRowRxToCx(erow *row, int rx) {
-    int current_rx = 0;
-    int cx;
-    for (cx = 0; cx < row -> size; cx++) {
-        if (row -> chars[cx] == '\t') 
-            current_rx += (KILO_TAB_STOP - 1) - (current_rx % KILO_TAB_STOP);
-        current_rx++;
-        if (current_rx > rx) return cx;
-    }
-    return cx;
-}
-
-int editorRowCxToRx(erow *row, int cx) {
-    int rx = 0;
-    for (int j = 0; j < cx; j++) {
-        if (row -> chars[j] == '\t') 
-            rx += (KILO_TAB_STOP - 1) - (rx % KILO_TAB_STOP);
-        rx++;
-    }
-    return rx;
-}
-
-// editorUpdateRow: Update the rendered version of a row (expand tabs)
-void editorUpdateRow(erow *row) {
-    int tabs = 0;
-    // Count number of tabs in the row
-    for (int i = 0; i < row -> size; i++) {
-        if (row -> chars[i] == '\t') tabs++;
-    }
-    // Allocate enough space for expanded tabs
-    free(row -> render);
-    row -> render = malloc(row -> size + (tabs * (KILO_TAB_STOP - 1)) + 1);
-    int idx = 0;
-    for (int i = 0; i < row -> size; i++) {
-        if (row -> chars[i] == '\t') {
-            // Insert a space, then pad with spaces to next tab stop
-            row -> render[idx++] = ' ';
-            while (idx % KILO_TAB_STOP != 0) row -> render[idx++] = ' ';
-        } else {
-            row -> render[idx++] = row -> chars[i];
-        }
-    }
-    row -> render[idx] = '\0';
-    row -> rsize = idx;
-}
-
-// editorInsertRow: Insert a new row at position 'at'
-void editorInsertRow(int at, char *s, size_t len) {
-    if (at < 0 || at > E.numrows) return;
-    // Make space for new row
-    E.row = realloc(E.row, sizeof(erow) * (E.numrows + 1));
-    memmove(&E.row[at + 1], &E.row[at], sizeof(erow) * (E.numrows - at));
-    // Initialize new row
-    E.row[at].size = len;
-    E.row[at].chars = malloc(len + 1);
-    memcpy(E.row[at].chars, s, len);
-    E.row[at].chars[len] = '\0';
-    E.row[at].rsize = 0;
-    E.row[at].render = NULL;
-    editorUpdateRow(&E.row[at]);
-    E.numrows++;
-    E.dirty_flag++;
-}
-
-void editorFreeRow(erow *row) {
-    free(row -> render);
-    free(row -> chars);
-}
-
-// editorDelRow: Delete a row at position 'at'
-void editorDelRow(int at) {
-    if (at < 0 || at >= E.numrows) return;
-    // Free memory for row
-    editorFreeRow(&E.row[at]);
-    // Shift rows up
-    memmove(&E.row[at], &E.row[at + 1], sizeof(erow) * (E.numrows - at - 1));
-    E.numrows--;
-    E.dirty_flag++;
-}
-
-void editorRowInsertChar(erow *row, int at, int c) {
-    if (at < 0 || at > row -> size) at = row -> size;
-    row -> chars = realloc(row -> chars, row -> size + 2);
-    memmove(&row -> chars[at + 1], &row -> chars[at], row -> size - at + 1);
-    row -> size++;
-    row -> chars[at] = c;
-    editorUpdateRow(row);
-    E.dirty_flag++;
-}
-
-void editorRowAppendString(erow *row, char *s, size_t len) {
-    row -> chars = realloc(row -> chars, row -> size + len + 1);
-    memcpy(&row -> chars[row -> size], s, len);
-    row -> size += len;
-    row -> chars[row -> size] = '\0';
-    editorUpdateRow(row);
-    E.dirty_flag++; 
-}
-
-void editorRowDelChar(erow *row, int at) {
-    if (at < 0 || at >= row -> size) return;
-    memmove(&row -> chars[at], &row -> chars[at + 1], row -> size - at);
-    row -> size--;
-    editorUpdateRow(row);
-    E.dirty_flag++;
-}
-
-// * EDITOR OPERATIONS ----------
-// Functions for editing: insert char, new line, delete char
-
-void editorInsertChar(int c) {
-    if (E.cy == E.numrows) {
-        editorInsertRow(E.numrows, "", 0);
-    }
-    editorRowInsertChar(&E.row[E.cy], E.cx, c);
-    E.cx++;
-}
-
-void editorInsertNewLine() {
-    if (E.cx == 0) {
-        editorInsertRow(E.cy, "", 0);
-    } else {
-        erow *row = &E.row[E.cy];
-        editorInsertRow(E.cy + 1, &row->chars[E.cx], row->size - E.cx);
-        row = &E.row[E.cy];
-        row->size = E.cx;
-        row->chars[row->size] = '\0';
-        editorUpdateRow(row);
-    }
-    E.cy++;
-    E.cx = 0;
-}
-
-void editorDelChar() {
-    if (E.cy == E.numrows) return;
-    if (E.cx == 0 && E.cy == 0) return;
-    erow *row = &E.row[E.cy];
-    if (E.cx > 0) { 
-        editorRowDelChar(row, E.cx - 1);
-        E.cx--;
-    } else {
-        E.cx = E.row[E.cy - 1].size;
-        editorRowAppendString(&E.row[E.cy - 1], row -> chars, row -> size);
-        editorDelRow(E.cy);
-        E.cy--;
-    }
-}
-
-// * FILE I/O ----------
-// Functions to load and save files
-
-char *editorRowsToString(int *buflen) {
-    int total_len = 0;
-    for (int i = 0; i < E.numrows; i++) {
-        total_len += E.row[i].size + 1;
-    }
-    *buflen = total_len;
-    char *buf = malloc(total_len);
-    char *p = buf;
-    for (int i = 0; i < E.numrows; i++) {
-        memcpy(p, E.row[i].chars, E.row[i].size);
-        p += E.row[i].size;
-        *p = '\n';
-        p++;
-    }
-    return buf;
-}
-
-void editorOpen(char *filename) {
-    free(E.filename);
-    E.filename = strdup(filename);
-
-    FILE *fp = fopen(filename, "r");
-    if (!fp) die("fopen");
-    char *line = NULL;
-    size_t linecap = 0;
-    ssize_t linelen;
-    while ((linelen = getline(&line, &linecap, fp)) != -1) {
-        while (linelen > 0 && (line[linelen - 1] == '\n' || line[linelen - 1] == '\r'))
-            linelen--;
-        editorInsertRow(E.numrows, line, linelen);
-    }
-    free(line);
-    fclose(fp);
-    E.dirty_flag = 0;
-}
-
-void editorSave() {
-    if (E.filename == NULL) {
-        E.filename = editorPrompt("Save as: %s (ESC to cancel)", NULL);
-        if (E.filename == NULL) {
-            editorSetStatusMessage("Save aborted");
-            return;
-        }
-    }
-    int len;
-    char *buf = editorRowsToString(&len);
-    int fd = open(E.filename, O_RDWR | O_CREAT, 0644);
-    if (fd != -1) {
-        if (ftruncate(fd, len) != -1) {
-            if (write(fd, buf, len) == len) {
-                close(fd);
-                free(buf);
-                E.dirty_flag = 0;
-                editorSetStatusMessage("%d bytes written to disk", len);
-                return;
-            }
-        }
-        close(fd);
-    }
-    free(buf);
-    editorSetStatusMessage("Cant Save! I/O error: %s", strerror(errno));
-}
-
-// * FIND ----------
-// Simple search functionality with callback for interactive search
-
-void editorFindCallback(char *query, int key) {
-    static int last_match = -1;
-    static int direction = 1;
-    // Handle navigation keys and reset on new search
-    if (key == '\r' || key == '\x1b') {
-        last_match = -1;
-        direction = 1;
-        return;
-    } else if (key == ARROW_RIGHT || key == ARROW_DOWN) {
-        direction = 1;
-    } else if (key == ARROW_LEFT || key == ARROW_UP) {
-        direction = -1;
-    } else {
-        last_match = -1;
-        direction = 1;
-    }
-    if (last_match == -1) direction = 1;
-    int current = last_match;
-    // Search through all rows in the given direction
-    for (int i = 0; i < E.numrows; i++) {
-        current += direction;
-        if (current == -1) current = E.numrows - 1;
-        else if (current == E.numrows) current = 0;
-        erow *row = &E.row[current];
-        char *match = strstr(row -> render, query);
-        if (match) {
-            // Found a match: update cursor and state
-            last_match = current;
-            E.cy = current;
-            E.cx = editorRowRxToCx(row, match - row -> render);
-            E.rowoff = E.numrows;
-            break;
-        }
-    }
-}
-
-void editorFind() {
-    int saved_cx = E.cx;
-    int saved_cy = E.cy;
-    int saved_coloff = E.coloff;
-    int saved_rowoff = E.rowoff;
-
-    char *query = editorPrompt("Search: %s (USE ESC/Arrows/Enter)", editorFindCallback);
-    if (query) free(query);
-    else {
-        E.cx = saved_cx;
-        E.cy = saved_cy;
-        E.coloff = saved_coloff;
-        E.rowoff = saved_rowoff;
-    }
-}
-
-// * APPEND BUFFER ----------
-// abuf: Dynamic string buffer for efficient screen drawing
-struct abuf {
-    char *b;
-    int len;
-};
-#define ABUF_INIT {NULL, 0}
-
-// abAppend: Append string to abuf
-void abAppend(struct abuf *ab, const char *s, int len) {
-    char *new = realloc(ab->b, ab->len + len);
-    if (new == NULL) return;
-    memcpy(&new[ab->len], s, len);
-    ab->b = new;
-    ab->len += len;
-}
-// abFree: Free abuf memory
-void abFree(struct abuf *ab) {
-    free(ab->b);
-}
-
-// * OUTPUT ----------
-// Functions to draw rows, status bar, message bar, and refresh the screen
-
-void editorScroll() {
-    E.rx = 0;
-    if (E.cy < E.numrows) {
-        E.rx = editorRowCxToRx(&E.row[E.cy], E.cx);
-    }
-    if (E.cy < E.rowoff) {
-        E.rowoff = E.cy;
-    }
-    if (E.cy >= E.rowoff + E.screenrows) {
-        E.rowoff = E.cy - E.screenrows + 1;
-    }
-    if (E.rx < E.coloff) {
-        E.coloff = E.rx;
-    }
-    if (E.rx >= E.coloff + E.screencols) {
-        E.coloff = E.rx - E.screencols + 1;
-    }
-}
-
-void editorDrawRows(struct abuf *ab) {
-  for (int y = 0; y < E.screenrows; y++) {
-        int filerow = y + E.rowoff;
-        if (filerow >= E.numrows) {
-            if (E.numrows == 0 && y == E.screenrows / 3) {
-                char welcome[80];
-                int welcomelen = snprintf(welcome, sizeof(welcome),
-                "Kilo editor -- version %s", KILO_VERSION);
-                if (welcomelen > E.screencols) welcomelen = E.screencols;
-                int padding = (E.screencols - welcomelen) / 2;
-                if (padding) {
-                    abAppend(ab, "~", 1);
-                    padding--;
-                }
-                while (padding--) abAppend(ab, " ", 1);
-                abAppend(ab, welcome, welcomelen);
-            } else {
-            abAppend(ab, "~", 1);
-            }
-        } else {
-            int len = E.row[filerow].rsize - E.coloff;
-            if (len < 0) len = 0;
-            if (len > E.screencols) len = E.screencols;
-            abAppend(ab, &E.row[filerow].render[E.coloff], len);
-        }
-        abAppend(ab, "\x1b[K", 3);
-        abAppend(ab, "\r\n", 2);
-    }
-}
-
-void editorDrawStatusBar(struct abuf *ab) {
-    abAppend(ab, "\x1b[7m", 4);  // Inverted colors
-    
-    char status[80], rstatus[80];
-    int len = snprintf(status, sizeof(status), "%.20s - %d lines", 
-                      E.filename ? E.filename : "[No Name]", E.numrows, E.dirty_flag ? "(modified)" : "");
-    int rlen = snprintf(rstatus, sizeof(rstatus), "%d/%d", E.cy + 1, E.numrows);
-    
-    if (len > E.screencols) len = E.screencols;
-    abAppend(ab, status, len);
-    
-    while (len < E.screencols) {  // Fixed: E.screencols instead of E.screenrows
-        if (E.screencols - len == rlen) {
-            abAppend(ab, rstatus, rlen);
-            break;
-        } else {
-            abAppend(ab, " ", 1);
-            len++;
-        }
-    }
-    
-    abAppend(ab, "\x1b[m", 3);  // Restore normal formatting
-    abAppend(ab, "\r\n", 2);    // Add a new line after the status bar
-}
-
-void editorDrawMessageBar(struct abuf *ab) {
-    abAppend(ab, "\x1b[K", 3);
-    int msglen = strlen(E.statusmsg);
-    if (msglen > E.screencols) msglen = E.screencols;
-    if (msglen && time(NULL) - E.status_time < 5)
-        abAppend(ab, E.statusmsg, msglen);
-}
-
-void editorRefreshScreen() {
-    editorScroll();
-    struct abuf ab = ABUF_INIT;
-
-    abAppend(&ab, "\x1b[?25l", 6); // Hide cursor
-    abAppend(&ab, "\x1b[H", 3);    // Move to top-left to start drawing
-
-    editorDrawRows(&ab);
-    editorDrawStatusBar(&ab);
-    editorDrawMessageBar(&ab);
-
-    // Move cursor to updated position
-    char buf[32];
-    snprintf(buf, sizeof(buf), "\x1b[%d;%dH", (E.cy - E.rowoff) + 1, (E.rx - E.coloff) + 1);
-    abAppend(&ab, buf, strlen(buf));
-
-    abAppend(&ab, "\x1b[?25h", 6); // Show cursor again
-
-    write(STDOUT_FILENO, ab.b, ab.len);
-    abFree(&ab);
-}
-
-void editorSetStatusMessage(const char* fmt, ...) {
-    va_list ap;
-    va_start(ap, fmt);
-    vsnprintf(E.statusmsg, sizeof(E.statusmsg), fmt, ap);
-    va_end(ap);
-    E.status_time = time(NULL);
-}
-
-
-// * INPUT ----------
-// editorPrompt: Prompt user for input (used for save-as, search, etc.)
-// editorMoveCursor: Handle cursor movement for arrow keys
-// editorProcessKeypress: Main input handler (dispatches on key pressed)
-
-char *editorPrompt(char *prompt, void (*callback)(char *, int)) {
-    size_t bufsize = 128;
-    char *buf = malloc(bufsize);
-    size_t buflen = 0;
-    buf[0] = '\0';
-
-    while (1) {
-        editorSetStatusMessage(prompt, buf);
-        editorRefreshScreen();
-
-        int c = editorReadKey();
-        // Handle backspace/delete
-        if (c == DEL_KEY || c == CTRL_KEY('h') || c == BACKSPACE) {
-            if (buflen != 0) buf[--buflen] = '\0';
-        } else if (c == '\x1b') {
-            // Cancel input
-            editorSetStatusMessage("");
-            if (callback) callback(buf, c);
-            free(buf);
-            return NULL;
-        } else if (c == '\r') {
-            // Enter: accept input if not empty
-            if (buflen != 0) {
-                editorSetStatusMessage("");
-                if (callback) callback(buf, c);
-                return buf;
-            }
-        } else if (!iscntrl(c) && c < 128) {
-            // Append normal character
-            if (buflen == bufsize - 1) {
-                bufsize *= 2;
-                buf = realloc(buf, bufsize);
-            }
-            buf[buflen++] = c;
-            buf[buflen] = '\0';
-        }
-        if (callback) callback(buf, c);
-    }
-}
-
-void editorMoveCursor(int key) {
-    erow *row = (E.cy >= E.numrows) ? NULL : &E.row[E.cy];
-    switch (key) {
-        case ARROW_LEFT:
-            if (E.cx != 0) {
-                E.cx--;
-            } else if (E.cy > 0) {
-                E.cy--;
-                E.cx = E.row[E.cy].size;
-            }
-        break;
-        case ARROW_RIGHT:
-            if (row && E.cx < row -> size) {
-                E.cx++;
-            } else if (row && E.cx == row -> size) {
-                E.cy++;
-                E.cx = 0;
-            }
-            break;
-        case ARROW_UP:
-            if (E.cy != 0) {
-                E.cy--;
-            }
-            break;
-        case ARROW_DOWN:
-            if (E.cy < E.numrows) {
-                E.cy++;
-            }
-            break;
-    }
-
-    row = (E.cy >= E.numrows) ? NULL : &E.row[E.cy];
-    int rowlen = row ? row -> size : 0;
-    if (E.cx > rowlen) {
-        E.cx = rowlen;
-    }
-}
-
-
-void editorProcessKeypress() {
-    static int quit_times = KILO_QUIT_TIMES;
-    int c = editorReadKey();
-    switch (c) {
-        case '\r':
-            editorInsertNewLine();
-            break;
-
-        case CTRL_KEY('q'):
-            if (E.dirty_flag && quit_times > 0) {
-                editorSetStatusMessage("WARNING! File has unsaved changes. ""Press Ctrl-Q %d more time(s) to quit.", quit_times);
-                quit_times--;
-                return;
-            }
-            write(STDOUT_FILENO, "\x1b[2J", 4);
-            write(STDOUT_FILENO, "\x1b[H", 3);
-            exit(0);
-            break;
-
-        case CTRL_KEY('s'):
-            editorSave();
-            break;
-        
-        case HOME_KEY:
-            E.cx = 0;
-            break;
-        case END_KEY:
-            if (E.cy < E.numrows) 
-                E.cx = E.row[E.cy].size;
-            break;    
-        
-        case CTRL_KEY('f'):
-            editorFind();
-            break;
-
-        case BACKSPACE:
-        case CTRL_KEY('h'):
-        case DEL_KEY:
-            if (c == DEL_KEY) editorMoveCursor(ARROW_RIGHT);
-            editorDelChar();
-            break;
-
-        case PAGE_UP:
-        case PAGE_DOWN: {
-            if (c == PAGE_UP) {
-                E.cy = E.rowoff;
-            } else if (c == PAGE_DOWN) {
-                E.cy = E.rowoff + E.screenrows - 1;
-                if (E.cy > E.numrows) E.cy = E.numrows;
-            }
-            int times = E.screenrows;
-            while (times--)
-                editorMoveCursor(c == PAGE_UP ? ARROW_UP : ARROW_DOWN);
-        }
-            break;
-        case ARROW_UP:
-        case ARROW_DOWN:
-        case ARROW_LEFT:
-        case ARROW_RIGHT:
-            editorMoveCursor(c);
-            break;
-
-        case CTRL_KEY('l'):
-        case '\x1b':
-            break;
-        
-        default:
-            editorInsertChar(c);
-            break;
-    }
-
-    quit_times = KILO_QUIT_TIMES;
-}
-
-// * INIT ----------
-// initEditor: Initialize editor state
-// main: Entry point, main loop
-
-void initEditor() {
-    E.cx = 0;
-    E.cy = 0;
-    E.rx = 0;
-    E.rowoff = 0;
-    E.coloff = 0;
-    E.numrows = 0;
-    E.row = NULL;
-    E.dirty_flag = 0;
-    E.filename = NULL;
-    E.statusmsg[0] = '\0';
-    E.status_time = 0;
-
-    if (getWindowSize(&E.screenrows, &E.screencols) == -1) die("getWindowSize");
-    E.screenrows -= 2;
-}
-
-int main(int argc, char *argv[]) {
-    enableRawMode();
-    initEditor();
-
-    if (argc >= 2) {
-        editorOpen(argv[1]);
-    }
-
-    editorSetStatusMessage("HELP: Ctrl-S = save | Ctrl-Q = quit | Ctrl-F = find");
-
-    char c;
-    while (1) {
-        editorRefreshScreen();
-        editorProcessKeypress();
-    }
-
-    return 0;
-}
+// kilo.c - A small, simple text editor in C
+// Inspired by kilo by Salvatore Sanfilippo (antirez)
+// Follows the tutorial by Jeremy Ruten (snaptoken)
+// This file implements a terminal-based text editor with basic features:
+
+// * INCLUDES ----------
+#define _DEFAULT_SOURCE
+#define _BSD_SOURCE
+#define _GNU_SOURCE
+
+#include <ctype.h>
+#include <errno.h>
+#include <poll.h>
+#include <regex.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+// * DEFINES ---------
+// KILO_VERSION: Editor version string
+#define KILO_VERSION "0.0.1"
+// KILO_TAB_STOP: Number of spaces per tab
+#define KILO_TAB_STOP 8
+// Rows at least this long get a windowed render (only the visible slice
+// is tab-expanded) so a single monster line doesn't cost O(length) per edit
+#define KILO_RENDER_WINDOW 65536
+// Wrap each frame in DEC private mode 2026 (synchronized update) so
+// capable terminals composite it atomically instead of flickering on
+// slow links; terminals without the mode ignore the escapes. Set to 0
+// for terminals known to mis-handle them.
+#define KILO_SYNC_UPDATE 1
+// Spacing (in chars) of the cached cx->rx checkpoints on long rows
+#define KILO_RX_CHECKPOINT 4096 
+// KILO_QUIT_TIMES: Times to press Ctrl-Q to quit with unsaved changes
+#define KILO_QUIT_TIMES 3
+// CTRL_KEY: Macro to get control-key value
+#define CTRL_KEY(k) ((k) & 0x1f)
+
+// editorKey: Enum for special key codes (arrows, delete, etc.)
+enum editorKey {
+    BACKSPACE = 127,
+    ARROW_LEFT = 1000,
+    ARROW_RIGHT,
+    ARROW_UP,
+    ARROW_DOWN,
+    DEL_KEY,
+    HOME_KEY,
+    END_KEY,
+    PAGE_UP,
+    PAGE_DOWN,
+    PASTE_START,   // bracketed paste: ESC [ 200 ~
+    PASTE_END,     // bracketed paste: ESC [ 201 ~
+    CTRL_ARROW_LEFT,   // word left:  ESC [ 1 ; 5 D
+    CTRL_ARROW_RIGHT,  // word right: ESC [ 1 ; 5 C
+    CTRL_ARROW_UP,     // paragraph up:   ESC [ 1 ; 5 A
+    CTRL_ARROW_DOWN    // paragraph down: ESC [ 1 ; 5 B
+};
+
+// * DATA ----------
+// editorHighlight: Classes a byte of a row's render can belong to
+enum editorHighlight {
+    HL_NORMAL = 0,
+    HL_COMMENT,
+    HL_MLCOMMENT,
+    HL_KEYWORD1,
+    HL_KEYWORD2,
+    HL_STRING,
+    HL_NUMBER
+};
+#define HL_HIGHLIGHT_NUMBERS (1 << 0)
+#define HL_HIGHLIGHT_STRINGS (1 << 1)
+
+// editorSyntax: One filetype's lexing rules
+struct editorSyntax {
+    char *filetype;
+    char **filematch;
+    char **keywords;
+    char *singleline_comment_start;
+    char *multiline_comment_start;
+    char *multiline_comment_end;
+    int flags;
+};
+
+// erow: Structure for a single line of text (with rendered version for tabs)
+// When a file is mmap-loaded, 'chars' initially points into the mapped region
+// (owns_chars == 0) and is copied to a private heap buffer on first edit.
+// 'hl' (one class byte per render byte) and the row's lexer end state are
+// computed lazily for displayed rows only; see SYNTAX HIGHLIGHTING.
+typedef struct erow {
+    int size;
+    int cap;            // bytes allocated for 'chars' (0 while borrowed)
+    int rsize;          // bytes in 'render' (the whole row, or just a window)
+    char *chars;
+    char *render;
+    int render_off;     // rx position of render[0]; 0 for full renders
+    int render_eol;     // nonzero when 'render' reaches the end of the row
+    int owns_chars;
+    unsigned char *hl;
+    int hl_valid;
+    int hl_end_state;   // in-multiline-comment state after this row
+    int *rx_ck;         // rx at every KILO_RX_CHECKPOINT chars (long rows)
+    int rx_ck_n;        // valid entries in rx_ck
+    int ascii_only;     // cached all-ASCII flag; -1 = not yet computed
+} erow;
+
+// textSlab: One slab of the row-text arena (see TEXT ARENA below)
+struct textSlab {
+    struct textSlab *next;
+    size_t used;
+    size_t cap;
+    char data[];
+};
+
+// editorConfig: Main editor state/configuration
+struct editorConfig {
+    int cx, cy;
+    int rx;
+    int rowoff;
+    int coloff;
+    int screenrows;
+    int screencols;
+    int numrows;
+    // The line table is a gap buffer: 'row' has capacity 'rowcap' erows,
+    // with a gap of (rowcap - numrows) unused slots starting at logical
+    // index 'row_gap'. Use editorRowAt() for all access.
+    erow *row;
+    int rowcap;
+    int row_gap;
+    int dirty_flag;
+    char *filename;
+    char statusmsg[80];
+    time_t status_time;
+    char *mapped;        // mmap'd file contents (NULL if not mmap-loaded)
+    size_t mapped_len;
+    struct textSlab *slabs;  // arena slabs holding load-time row text
+    FILE *journal;           // append-only edit journal (see JOURNAL)
+    char *journal_path;
+    struct editorSyntax *syntax; // filetype rules, NULL = no highlighting
+    struct termios orig_termios;
+};
+struct editorConfig E;
+
+// loaderLine: One scanned line boundary (offset/length into E.mapped)
+struct loaderLine {
+    size_t off;
+    size_t len;
+};
+
+// editorLoader: Background-scan state (see BACKGROUND LOADER below);
+// 'lock' guards everything from 'done' down
+struct editorLoader {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    int active;              // scan started and not fully drained yet
+    int done;                // scan thread has published its last batch
+    size_t scanned;          // bytes scanned so far, for progress display
+    struct loaderLine *pending;
+    int npending;
+    int pendcap;
+};
+struct editorLoader L;
+
+// followState: Tail-follow (Ctrl-T) watch handle plus the byte offset of
+// the file already turned into rows (see the FOLLOW section)
+struct followState {
+    int active;
+    int ifd;             // inotify fd (nonblocking)
+    int wd;              // watch descriptor
+    off_t offset;        // bytes of the file already turned into rows
+    char *carry;         // trailing partial line awaiting its newline
+    size_t carry_len;
+};
+struct followState FW;
+
+// * PROTOTYPES ----------
+// Function declarations for status, screen refresh, and prompt
+void editorSetStatusMessage(const char *fmt, ...);
+void editorRefreshScreen();
+char *editorPrompt(char *prompt, void (*callback)(char *, int));
+void journalOp(char op, int a, int b, const char *text, size_t len);
+extern int journal_replaying;
+void byteIndexMarkDirty();
+void byteIndexAdd(int at, long long delta);
+void byteIndexEnsure();
+int editorRowRenderCols(erow *row);
+int termWriteAll(const char *buf, size_t len);
+void sessionApplyPending();
+
+
+// * INSTRUMENTATION ----------
+// Nanosecond counters around the hot paths, accumulated into log2-bucket
+// histograms. Recording is two clock reads and an array increment, so
+// the overhead is invisible next to the work being measured; nothing at
+// all runs while idle.
+
+#define PERF_BUCKETS 40
+
+enum perfMetric {
+    PERF_REFRESH,    // editorRefreshScreen(), whole frame
+    PERF_RENDER,     // one row render (full or windowed)
+    PERF_KEYWAIT,    // time blocked waiting for input
+    PERF_FIND,       // one find-callback step
+    PERF_K2F,        // keystroke arrival to end of next frame
+    PERF_NMETRICS
+};
+
+const char *perf_names[PERF_NMETRICS] = {
+    "refresh", "render", "key_wait", "find", "key_to_frame"
+};
+
+// perfHist: counts[b] holds samples in [2^b, 2^(b+1)) nanoseconds
+struct perfHist {
+    long long counts[PERF_BUCKETS];
+    long long total_ns;
+    long long n;
+};
+struct perfHist perf[PERF_NMETRICS];
+
+int perf_visible;          // Ctrl-P: show latency digest in the status bar
+long long perf_key_ns;     // arrival time of the batch's first keystroke
+
+// perfNow: Monotonic clock in nanoseconds
+long long perfNow() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// perfRecord: Add one sample to metric 'm'
+void perfRecord(int m, long long ns) {
+    if (ns < 0) ns = 0;
+    int b = 0;
+    long long v = ns;
+    while (v > 1 && b < PERF_BUCKETS - 1) {
+        v >>= 1;
+        b++;
+    }
+    perf[m].counts[b]++;
+    perf[m].total_ns += ns;
+    perf[m].n++;
+}
+
+// perfPercentile: Upper bound (ns) of the bucket holding percentile 'pct'
+long long perfPercentile(int m, int pct) {
+    if (perf[m].n == 0) return 0;
+    long long rank = (perf[m].n * pct + 99) / 100;
+    long long seen = 0;
+    for (int b = 0; b < PERF_BUCKETS; b++) {
+        seen += perf[m].counts[b];
+        if (seen >= rank) return 2LL << b;
+    }
+    return 2LL << (PERF_BUCKETS - 1);
+}
+
+// perfDump: Write the histograms to $KILO_STATS on exit, one JSON object
+// per metric, so fleet sessions can be aggregated offline
+void perfDump() {
+    char *path = getenv("KILO_STATS");
+    if (path == NULL) return;
+    FILE *f = fopen(path, "w");
+    if (f == NULL) return;
+    for (int m = 0; m < PERF_NMETRICS; m++) {
+        if (perf[m].n == 0) continue;
+        fprintf(f, "{\"metric\": \"%s\", \"n\": %lld, \"mean_ns\": %lld, "
+                   "\"p50_ns\": %lld, \"p99_ns\": %lld, \"buckets\": [",
+                perf_names[m], perf[m].n, perf[m].total_ns / perf[m].n,
+                perfPercentile(m, 50), perfPercentile(m, 99));
+        for (int b = 0; b < PERF_BUCKETS; b++)
+            fprintf(f, "%s%lld", b ? "," : "", perf[m].counts[b]);
+        fprintf(f, "]}\n");
+    }
+    fclose(f);
+}
+
+// * TERMINAL ----------
+// termWriteAll: Write the whole buffer to the terminal, retrying through
+// short writes and EAGAIN (polling for writability rather than spinning)
+// so a frame larger than the kernel's pipe buffer reaches the terminal
+// intact instead of tearing. Returns -1 only on a real write error.
+int termWriteAll(const char *buf, size_t len) {
+    size_t off = 0;
+    while (off < len) {
+        ssize_t n = write(STDOUT_FILENO, buf + off, len - off);
+        if (n > 0) {
+            off += (size_t)n;
+            continue;
+        }
+        if (n == -1 && errno != EAGAIN && errno != EINTR) return -1;
+        struct pollfd pfd = { .fd = STDOUT_FILENO, .events = POLLOUT };
+        poll(&pfd, 1, -1);
+    }
+    return 0;
+}
+
+// die: Exit with error, clear screen
+void die(const char *s) {
+    termWriteAll("\x1b[2J\x1b[H", 7);
+    
+    perror(s);
+    exit(1);
+}
+
+// disableRawMode: Restore terminal to original mode
+void disableRawMode() {
+    write(STDOUT_FILENO, "\x1b[?2004l", 8); // Bracketed paste off
+    if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &E.orig_termios) == -1)
+        die("tcsetattr");
+}
+
+// enableRawMode: Set terminal to raw mode for direct input
+void enableRawMode() {
+    if (tcgetattr(STDIN_FILENO, &E.orig_termios) == -1) die("tcgetattr");
+    atexit(disableRawMode);
+    
+    struct termios raw = E.orig_termios;
+    raw.c_iflag &= ~(BRKINT | ICRNL | INPCK | ISTRIP | IXON);
+    raw.c_oflag &= ~(OPOST);
+    raw.c_cflag |= (CS8);
+    raw.c_lflag &= ~(ECHO | ICANON | IEXTEN | ISIG);
+    
+    raw.c_cc[VMIN] = 0;
+    raw.c_cc[VTIME] = 1;
+
+    if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) == -1) die("tcsetattr");
+    write(STDOUT_FILENO, "\x1b[?2004h", 8); // Bracketed paste on
+}
+
+// Raw input is drained in bulk: one read() pulls everything currently
+// available into a buffer and keys are decoded from that, so a large
+// paste costs a handful of syscalls (and, via the main loop, one screen
+// refresh per drained batch) instead of one of each per character.
+
+// KILO_INBUF_SIZE: Bytes drained from the terminal per read()
+#define KILO_INBUF_SIZE 4096
+
+// inputBuf: Drained-but-not-yet-decoded terminal input
+struct inputBuf {
+    char buf[KILO_INBUF_SIZE];
+    int len;
+    int pos;
+};
+struct inputBuf IB;
+
+// inputPending: Bytes already drained but not yet decoded
+int inputPending() {
+    return IB.len - IB.pos;
+}
+
+// inputFill: One read() attempt (bounded by VTIME); returns bytes available
+int inputFill() {
+    if (IB.pos < IB.len) return IB.len - IB.pos;
+    IB.pos = 0;
+    IB.len = 0;
+    int nread = read(STDIN_FILENO, IB.buf, sizeof(IB.buf));
+    if (nread == -1 && errno != EAGAIN) die("read");
+    if (nread > 0) IB.len = nread;
+    return IB.len;
+}
+
+// editorReadByte: Next input byte, blocking until one arrives. While the
+// background loader is active the screen keeps refreshing between read
+// timeouts so loading progress stays live.
+int editorReadByte() {
+    long long t0 = perfNow();
+    while (inputFill() == 0) {
+        // Keep the screen live between read timeouts while background
+        // work (loading, following a growing file) is in progress
+        if (L.active || FW.active) editorRefreshScreen();
+        // A read timeout means the operator paused: catch up on the
+        // deferred line-index rebuild now, off the keystroke path (but
+        // not while the loader is still growing the row table)
+        if (!L.active) byteIndexEnsure();
+    }
+    long long now = perfNow();
+    perfRecord(PERF_KEYWAIT, now - t0);
+    if (perf_key_ns == 0) perf_key_ns = now;
+    return (unsigned char)IB.buf[IB.pos++];
+}
+
+// editorReadByteTimeout: One timed read attempt; -1 if nothing arrived
+int editorReadByteTimeout() {
+    if (inputFill() == 0) return -1;
+    return (unsigned char)IB.buf[IB.pos++];
+}
+
+// editorReadKey: Read a keypress, handle escape sequences for special keys
+int editorReadKey() {
+    int c = editorReadByte();
+    if (c == '\x1b') {
+        // Handle escape sequences for special keys (arrows, home, end, etc.)
+        int seq[3];
+        if ((seq[0] = editorReadByteTimeout()) == -1) return '\x1b';
+        if ((seq[1] = editorReadByteTimeout()) == -1) return '\x1b';
+        if (seq[0] == '[') {
+            // CSI sequences: ESC [ ...
+            if (seq[1] >= '0' && seq[1] <= '9') {
+                // Extended escape sequence: ESC [ <num> ~
+                // (multi-digit for bracketed paste markers 200/201)
+                int num = seq[1] - '0';
+                while ((seq[2] = editorReadByteTimeout()) != -1 &&
+                       seq[2] >= '0' && seq[2] <= '9')
+                    num = num * 10 + (seq[2] - '0');
+                if (seq[2] == '~') {
+                    switch (num) {
+                        case 1: return HOME_KEY;
+                        case 3: return DEL_KEY;
+                        case 4: return END_KEY;
+                        case 5: return PAGE_UP;
+                        case 6: return PAGE_DOWN;
+                        case 7: return HOME_KEY;
+                        case 8: return END_KEY;
+                        case 200: return PASTE_START;
+                        case 201: return PASTE_END;
+                    }
+                } else if (seq[2] == ';' && num == 1) {
+                    // Modified keys: ESC [ 1 ; <mod> <dir>; 5 is Ctrl
+                    int mod = editorReadByteTimeout();
+                    int dir = editorReadByteTimeout();
+                    if (mod == '5') {
+                        switch (dir) {
+                            case 'A': return CTRL_ARROW_UP;
+                            case 'B': return CTRL_ARROW_DOWN;
+                            case 'C': return CTRL_ARROW_RIGHT;
+                            case 'D': return CTRL_ARROW_LEFT;
+                        }
+                    }
+                }
+            } else {
+                // Simple arrow/home/end: ESC [ A/B/C/D/H/F
+                switch (seq[1]) {
+                    case 'A': return ARROW_UP;
+                    case 'B': return ARROW_DOWN;
+                    case 'C': return ARROW_RIGHT;
+                    case 'D': return ARROW_LEFT;
+                    case 'H': return HOME_KEY;
+                    case 'F': return END_KEY;
+                }
+            }
+        } else if (seq[0] == 'O') {
+            // ESC O H/F (alternative home/end)
+            switch (seq[1]) {
+                case 'H': return HOME_KEY;
+                case 'F': return END_KEY;
+            }
+        }
+        return '\x1b'; // Unrecognized escape sequence
+    } else {
+        return c; // Normal character
+    }
+}
+
+// getCursorPosition: Query terminal for cursor position
+int getCursorPosition(int *rows, int *cols) {
+    char buf[32];
+    unsigned int i = 0;
+    // Request cursor position report
+    if (write(STDOUT_FILENO, "\x1b[6n", 4) != 4) return -1;
+    // Read response: ESC [ rows ; cols R
+    while (i < sizeof(buf) - 1) {
+        if (read(STDIN_FILENO, &buf[i], 1) != 1) break;
+        if (buf[i] == 'R') break;
+        i++;
+    }
+    buf[i] = '\0';
+    // Parse response
+    if (buf[0] != '\x1b' || buf[1] != '[') return -1;
+    if (sscanf(&buf[2], "%d;%d", rows, cols) != 2) return -1;
+    return 0;
+}
+
+// getWindowSize: Get terminal window size (rows, cols)
+int getWindowSize(int *rows, int *cols) {
+    struct winsize ws;
+    // Try ioctl first
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == -1 || ws.ws_col == 0) {
+        // Fallback: move cursor to bottom-right and query position
+        if (write(STDOUT_FILENO, "\x1b[999C\x1b[999B", 12) != 12) return -1;
+        return getCursorPosition(rows, cols);
+    } else {
+        *cols = ws.ws_col;
+        *rows = ws.ws_row;
+        return 0;
+    }
+}
+
+// * TEXT ARENA ----------
+// Row text loaded through the stdio fallback path is bump-allocated out
+// of large slabs instead of one malloc per row: adjacent rows' bytes stay
+// adjacent in memory for editorDrawRows()' sequential walk, and the whole
+// arena is reclaimed slab-at-a-time when the buffer goes away. Arena rows
+// carry owns_chars == 0, so the first edit materializes them onto the
+// heap exactly like mmap-backed rows.
+
+// KILO_SLAB_SIZE: Default arena slab payload size
+#define KILO_SLAB_SIZE (1 << 20)
+
+// editorArenaAlloc: Bump-allocate 'len' bytes of row text
+char *editorArenaAlloc(size_t len) {
+    struct textSlab *s = E.slabs;
+    if (s == NULL || s -> cap - s -> used < len) {
+        size_t cap = len > KILO_SLAB_SIZE ? len : KILO_SLAB_SIZE;
+        s = malloc(sizeof(struct textSlab) + cap);
+        s -> next = E.slabs;
+        s -> used = 0;
+        s -> cap = cap;
+        E.slabs = s;
+    }
+    char *p = s -> data + s -> used;
+    s -> used += len;
+    return p;
+}
+
+// editorArenaFree: Release every slab at once (buffer close/teardown)
+void editorArenaFree() {
+    struct textSlab *s = E.slabs;
+    while (s) {
+        struct textSlab *next = s -> next;
+        free(s);
+        s = next;
+    }
+    E.slabs = NULL;
+}
+
+// * ROW OPERATIONS ----------
+// Functions to manipulate lines (rows): insert, delete, update, etc.
+
+// editorRowAt: Logical index -> erow pointer, skipping over the gap.
+// O(1), so sequential walks (editorDrawRows etc.) stay cheap.
+erow *editorRowAt(int at) {
+    if (at >= E.row_gap) at += E.rowcap - E.numrows;
+    return &E.row[at];
+}
+
+// editorRowIndex: erow pointer -> logical index (inverse of editorRowAt)
+int editorRowIndex(erow *row) {
+    int phys = row - E.row;
+    int gaplen = E.rowcap - E.numrows;
+    return phys < E.row_gap ? phys : phys - gaplen;
+}
+
+// editorRowGapSeek: Slide the gap so it starts at logical index 'at'.
+// Cost is proportional to the distance moved, not to numrows, so
+// repeated edits in one area of the file are near-free.
+void editorRowGapSeek(int at) {
+    int gaplen = E.rowcap - E.numrows;
+    if (gaplen == 0) {
+        E.row_gap = at;
+        return;
+    }
+    if (at < E.row_gap) {
+        memmove(&E.row[at + gaplen], &E.row[at], sizeof(erow) * (E.row_gap - at));
+    } else if (at > E.row_gap) {
+        memmove(&E.row[E.row_gap], &E.row[E.row_gap + gaplen], sizeof(erow) * (at - E.row_gap));
+    }
+    E.row_gap = at;
+}
+
+// editorRowGapGrow: Ensure at least one free slot, doubling capacity so
+// load-time appends are amortized O(1) instead of one realloc per row.
+void editorRowGapGrow() {
+    if (E.numrows < E.rowcap) return;
+    editorRowGapSeek(E.numrows);
+    int newcap = E.rowcap ? E.rowcap * 2 : 64;
+    E.row = realloc(E.row, sizeof(erow) * newcap);
+    E.rowcap = newcap;
+}
+
+// editorRowAscii: Cached all-ASCII test. The scan ORs eight bytes at a
+// time and checks the high bits once, so a megabyte row costs ~128k
+// word ops the first time and nothing after an edit-free stretch.
+int editorRowAscii(erow *row) {
+    if (row -> ascii_only != -1) return row -> ascii_only;
+    const char *p = row -> chars;
+    int n = row -> size;
+    unsigned long long acc = 0;
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        unsigned long long w;
+        memcpy(&w, p + i, 8);
+        acc |= w;
+    }
+    unsigned char tail = 0;
+    for (; i < n; i++) tail |= (unsigned char)p[i];
+    row -> ascii_only = ((acc & 0x8080808080808080ULL) == 0) && ((tail & 0x80) == 0);
+    return row -> ascii_only;
+}
+
+// utf8IsCont: Continuation byte of a multi-byte sequence; occupies no
+// display column of its own
+int utf8IsCont(unsigned char c) {
+    return (c & 0xC0) == 0x80;
+}
+
+// utf8DecodePoint: Decode the sequence whose lead byte is s[0] (n bytes
+// available) into a code point. Malformed input decodes as the lead
+// byte alone, so every byte still lands somewhere on screen.
+unsigned utf8DecodePoint(const char *s, int n) {
+    unsigned char lead = s[0];
+    int len;
+    unsigned cp;
+    if (lead < 0xC0)      { return lead; }
+    else if (lead < 0xE0) { len = 2; cp = lead & 0x1F; }
+    else if (lead < 0xF0) { len = 3; cp = lead & 0x0F; }
+    else if (lead < 0xF8) { len = 4; cp = lead & 0x07; }
+    else                  { return lead; }
+    if (len > n) return lead;
+    for (int i = 1; i < len; i++) {
+        if (!utf8IsCont((unsigned char)s[i])) return lead;
+        cp = (cp << 6) | ((unsigned char)s[i] & 0x3F);
+    }
+    return cp;
+}
+
+// utf8RangeTable: Sorted, inclusive code point intervals for binary
+// search. Condensed from the Unicode tables the way wcwidth()
+// implementations do it - close enough for cursor placement; exotic
+// scripts outside these ranges fall back to single width.
+struct utf8Range { unsigned first, last; };
+
+// Zero-width: combining marks, variation selectors, ZW spaces/joiners
+const struct utf8Range utf8_zero[] = {
+    {0x0300, 0x036F}, {0x0483, 0x0489}, {0x0591, 0x05BD},
+    {0x05BF, 0x05BF}, {0x0610, 0x061A}, {0x064B, 0x065F},
+    {0x0670, 0x0670}, {0x06D6, 0x06DC}, {0x06DF, 0x06E4},
+    {0x0730, 0x074A}, {0x07EB, 0x07F3}, {0x0900, 0x0902},
+    {0x093C, 0x093C}, {0x0941, 0x0948}, {0x094D, 0x094D},
+    {0x0951, 0x0954}, {0x0E31, 0x0E31}, {0x0E34, 0x0E3A},
+    {0x0E47, 0x0E4E}, {0x1AB0, 0x1AFF}, {0x1DC0, 0x1DFF},
+    {0x200B, 0x200F}, {0x202A, 0x202E}, {0x20D0, 0x20FF},
+    {0xFE00, 0xFE0F}, {0xFE20, 0xFE2F},
+};
+
+// Double-width: East Asian Wide and Fullwidth, plus emoji blocks
+const struct utf8Range utf8_wide[] = {
+    {0x1100, 0x115F},   {0x2329, 0x232A},   {0x2E80, 0x303E},
+    {0x3041, 0x33FF},   {0x3400, 0x4DBF},   {0x4E00, 0x9FFF},
+    {0xA000, 0xA4CF},   {0xA960, 0xA97F},   {0xAC00, 0xD7A3},
+    {0xF900, 0xFAFF},   {0xFE10, 0xFE19},   {0xFE30, 0xFE52},
+    {0xFE54, 0xFE66},   {0xFE68, 0xFE6B},   {0xFF00, 0xFF60},
+    {0xFFE0, 0xFFE6},   {0x1F300, 0x1F64F}, {0x1F900, 0x1F9FF},
+    {0x20000, 0x2FFFD}, {0x30000, 0x3FFFD},
+};
+
+int utf8RangeHas(const struct utf8Range *t, int n, unsigned cp) {
+    if (cp < t[0].first || cp > t[n - 1].last) return 0;
+    int lo = 0, hi = n - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (cp < t[mid].first) hi = mid - 1;
+        else if (cp > t[mid].last) lo = mid + 1;
+        else return 1;
+    }
+    return 0;
+}
+
+// utf8Width: Display columns taken by the sequence starting at 's'
+// (n bytes available): 0 for combining marks, 2 for East Asian wide
+// and fullwidth, 1 for everything else. ASCII never reaches the
+// tables - callers keep it on their byte == column fast path.
+int utf8Width(const char *s, int n) {
+    unsigned cp = utf8DecodePoint(s, n);
+    if (utf8RangeHas(utf8_zero, sizeof(utf8_zero) / sizeof(utf8_zero[0]), cp))
+        return 0;
+    if (utf8RangeHas(utf8_wide, sizeof(utf8_wide) / sizeof(utf8_wide[0]), cp))
+        return 2;
+    return 1;
+}
+
+// editorRowCkExtend: Make sure the rx checkpoint table covers char index
+// 'cx'. Checkpoints are exact (computed by the same scan the mappings
+// use) and extend incrementally, so after an edit only the stretch past
+// the edit point is ever rescanned.
+void editorRowCkExtend(erow *row, int cx) {
+    if (row -> size < KILO_RX_CHECKPOINT) return;
+    int max = row -> size / KILO_RX_CHECKPOINT + 1;
+    int want = cx / KILO_RX_CHECKPOINT + 1;
+    if (want > max) want = max;
+    if (row -> rx_ck_n >= want) return;
+    // The row may have grown since the table was sized; realloc to 'max'
+    row -> rx_ck = realloc(row -> rx_ck, max * sizeof(int));
+    if (row -> rx_ck_n == 0) {
+        row -> rx_ck[0] = 0;
+        row -> rx_ck_n = 1;
+    }
+    int k = row -> rx_ck_n;
+    int rx = row -> rx_ck[k - 1];
+    int j = (k - 1) * KILO_RX_CHECKPOINT;
+    while (k < want) {
+        int stop = k * KILO_RX_CHECKPOINT;
+        for (; j < stop; j++) {
+            unsigned char c = row -> chars[j];
+            if (utf8IsCont(c)) continue;
+            if (c == '\t')
+                rx += KILO_TAB_STOP - (rx % KILO_TAB_STOP);
+            else if (c < 0x80)
+                rx++;
+            else
+                rx += utf8Width(&row -> chars[j], row -> size - j);
+        }
+        row -> rx_ck[k++] = rx;
+    }
+    row -> rx_ck_n = k;
+}
+
+// editorRowRxToCx: Seek to the last checkpoint at or before 'rx', then
+// scan forward. A non-combining char is at least one column wide, so
+// checkpoints up to cx == rx bracket it; runs of zero-width combining
+// marks can stretch the final scan past one checkpoint interval, but
+// never change the answer.
+int editorRowRxToCx(erow *row, int rx) {
+    int current_rx = 0;
+    int cx = 0;
+    if (row -> size >= KILO_RX_CHECKPOINT && rx >= KILO_RX_CHECKPOINT) {
+        editorRowCkExtend(row, rx < row -> size ? rx : row -> size);
+        int lo = 0, hi = row -> rx_ck_n - 1;
+        while (lo < hi) {
+            int mid = (lo + hi + 1) / 2;
+            if (row -> rx_ck[mid] <= rx) lo = mid; else hi = mid - 1;
+        }
+        cx = lo * KILO_RX_CHECKPOINT;
+        current_rx = row -> rx_ck[lo];
+    }
+    for (; cx < row -> size; cx++) {
+        unsigned char c = row -> chars[cx];
+        if (utf8IsCont(c)) continue;
+        if (c == '\t')
+            current_rx += KILO_TAB_STOP - (current_rx % KILO_TAB_STOP);
+        else if (c < 0x80)
+            current_rx++;
+        else
+            current_rx += utf8Width(&row -> chars[cx], row -> size - cx);
+        if (current_rx > rx) return cx;
+    }
+    return cx;
+}
+
+// editorRowCxToRx: Resume from the nearest cached checkpoint instead of
+// rescanning the row from the start on every cursor movement.
+int editorRowCxToRx(erow *row, int cx) {
+    int rx = 0;
+    int j = 0;
+    if (row -> size >= KILO_RX_CHECKPOINT && cx >= KILO_RX_CHECKPOINT) {
+        editorRowCkExtend(row, cx);
+        int k = cx / KILO_RX_CHECKPOINT;
+        if (k >= row -> rx_ck_n) k = row -> rx_ck_n - 1;
+        j = k * KILO_RX_CHECKPOINT;
+        rx = row -> rx_ck[k];
+    }
+    for (; j < cx; j++) {
+        unsigned char c = row -> chars[j];
+        if (utf8IsCont(c)) continue;
+        if (c == '\t')
+            rx += KILO_TAB_STOP - (rx % KILO_TAB_STOP);
+        else if (c < 0x80)
+            rx++;
+        else
+            rx += utf8Width(&row -> chars[j], row -> size - j);
+    }
+    return rx;
+}
+
+// editorUpdateRow: Update the rendered version of a row (expand tabs).
+// The old byte-by-byte loops were the hottest code when loading or
+// bulk-editing; scanning with memchr() (vectorized inside libc) makes
+// the common tab-free row a single memcpy, and rows with tabs are
+// copied in whole chunks between tab positions.
+void editorUpdateRow(erow *row) {
+    free(row -> render);
+    char *end = row -> chars + row -> size;
+    char *first_tab = memchr(row -> chars, '\t', row -> size);
+    row -> render_off = 0;
+    row -> render_eol = 1;
+    if (first_tab == NULL) {
+        // Fast path: no tabs, render is a straight copy
+        row -> render = malloc(row -> size + 1);
+        memcpy(row -> render, row -> chars, row -> size);
+        row -> render[row -> size] = '\0';
+        row -> rsize = row -> size;
+        return;
+    }
+    // Count tabs to size the allocation
+    int tabs = 0;
+    for (char *p = first_tab; p; p = memchr(p + 1, '\t', end - (p + 1)))
+        tabs++;
+    row -> render = malloc(row -> size + (tabs * (KILO_TAB_STOP - 1)) + 1);
+    // Copy chunk-wise, padding to the next tab stop at each tab
+    int idx = 0;
+    char *p = row -> chars;
+    while (p < end) {
+        char *tab = memchr(p, '\t', end - p);
+        size_t chunk = (tab ? tab : end) - p;
+        memcpy(&row -> render[idx], p, chunk);
+        idx += chunk;
+        p += chunk;
+        if (tab) {
+            // Insert a space, then pad with spaces to next tab stop
+            row -> render[idx++] = ' ';
+            while (idx % KILO_TAB_STOP != 0) row -> render[idx++] = ' ';
+            p++;
+        }
+    }
+    row -> render[idx] = '\0';
+    row -> rsize = idx;
+}
+
+// editorRowEnsureRender: Compute the rendered form lazily, on first
+// access. A NULL 'render' means not-yet-computed (or invalidated), so
+// rows that are never displayed or searched never pay for tab expansion.
+void editorRowEnsureRender(erow *row) {
+    if (row -> render == NULL) {
+        long long t0 = perfNow();
+        editorUpdateRow(row);
+        perfRecord(PERF_RENDER, perfNow() - t0);
+    }
+}
+
+// editorRowEnsureRenderWindow: Like editorRowEnsureRender(), but rows past
+// KILO_RENDER_WINDOW only get the slice around [rx_start, rx_start+rx_len)
+// tab-expanded, with a screen of slack on either side so plain horizontal
+// scrolling doesn't re-render. Editing a monster line then costs O(screen
+// width), not O(line length).
+void editorRowEnsureRenderWindow(erow *row, int rx_start, int rx_len) {
+    if (row -> size < KILO_RENDER_WINDOW) {
+        editorRowEnsureRender(row);
+        return;
+    }
+    if (row -> render && rx_start >= row -> render_off &&
+        (row -> render_eol ||
+         rx_start + rx_len <= row -> render_off + editorRowRenderCols(row)))
+        return;
+    long long t0 = perfNow();
+    free(row -> render);
+    free(row -> hl);
+    row -> hl = NULL;
+    row -> hl_valid = 0;
+    int win_lo = rx_start > rx_len ? rx_start - rx_len : 0;
+    int win_hi = rx_start + 2 * rx_len;
+    // Snap the window start back to a char boundary
+    int cx = editorRowRxToCx(row, win_lo);
+    int rx = editorRowCxToRx(row, cx);
+    row -> render_off = rx;
+    // Sized for one sequence per column; zero-width combining marks can
+    // pack more bytes into a column, so the buffer grows on demand
+    size_t cap = (size_t)(win_hi - rx) * 4 + KILO_TAB_STOP + 1;
+    char *out = malloc(cap);
+    int idx = 0; // bytes written
+    int col = 0; // columns covered
+    while (cx < row -> size && rx + col < win_hi) {
+        if ((size_t)idx + KILO_TAB_STOP + 4 >= cap) {
+            cap *= 2;
+            out = realloc(out, cap);
+        }
+        unsigned char c = row -> chars[cx++];
+        if (c == '\t') {
+            out[idx++] = ' ';
+            col++;
+            while ((rx + col) % KILO_TAB_STOP != 0) {
+                out[idx++] = ' ';
+                col++;
+            }
+        } else {
+            out[idx++] = c;
+            if (!utf8IsCont(c) && c >= 0x80)
+                col += utf8Width(&row -> chars[cx - 1], row -> size - (cx - 1));
+            else if (!utf8IsCont(c))
+                col++;
+        }
+    }
+    out[idx] = '\0';
+    row -> render = out;
+    row -> rsize = idx;
+    row -> render_eol = (cx >= row -> size);
+    perfRecord(PERF_RENDER, perfNow() - t0);
+}
+
+// editorRowRenderCols: Display columns covered by the cached render.
+// Equal to rsize for all-ASCII rows; otherwise each sequence counts
+// its display width (0 for combining marks, 2 for East Asian wide).
+int editorRowRenderCols(erow *row) {
+    if (editorRowAscii(row)) return row -> rsize;
+    int cols = 0;
+    for (int b = 0; b < row -> rsize; b++) {
+        unsigned char c = row -> render[b];
+        if (utf8IsCont(c)) continue;
+        cols += c < 0x80 ? 1 : utf8Width(&row -> render[b], row -> rsize - b);
+    }
+    return cols;
+}
+
+// editorRowRenderColToByte: Byte offset in 'render' of display column
+// 'col' (counted from render[0]). Identity for all-ASCII rows
+int editorRowRenderColToByte(erow *row, int col) {
+    if (editorRowAscii(row)) return col;
+    int c = 0;
+    for (int b = 0; b < row -> rsize; b++) {
+        unsigned char ch = row -> render[b];
+        if (utf8IsCont(ch)) continue;
+        int w = ch < 0x80 ? 1 : utf8Width(&row -> render[b], row -> rsize - b);
+        // Zero-width marks stay attached to the char before them
+        if (w > 0 && c >= col) return b;
+        c += w;
+    }
+    return row -> rsize;
+}
+
+// editorRowRenderByteToCol: Display column of byte offset 'b' in
+// 'render'; the inverse of editorRowRenderColToByte()
+int editorRowRenderByteToCol(erow *row, int b) {
+    if (editorRowAscii(row)) return b;
+    int col = 0;
+    for (int i = 0; i < b && i < row -> rsize; i++) {
+        unsigned char c = row -> render[i];
+        if (utf8IsCont(c)) continue;
+        col += c < 0x80 ? 1 : utf8Width(&row -> render[i], row -> rsize - i);
+    }
+    return col;
+}
+
+// editorRowInvalidateRender: Drop the cached render (and its highlight)
+// after a text change; both are rebuilt on the next access
+void editorRowInvalidateRender(erow *row) {
+    free(row -> render);
+    row -> render = NULL;
+    row -> rsize = 0;
+    row -> render_off = 0;
+    free(row -> hl);
+    row -> hl = NULL;
+    row -> hl_valid = 0;
+    free(row -> rx_ck);
+    row -> rx_ck = NULL;
+    row -> rx_ck_n = 0;
+    row -> ascii_only = -1;
+}
+
+// editorRowInvalidateFrom: Invalidate after an edit at char index 'cx'.
+// Checkpoints before the edit point are still exact and are kept, so the
+// next mapping query only rescans from the edit onward.
+void editorRowInvalidateFrom(erow *row, int cx) {
+    free(row -> render);
+    row -> render = NULL;
+    row -> rsize = 0;
+    row -> render_off = 0;
+    free(row -> hl);
+    row -> hl = NULL;
+    row -> hl_valid = 0;
+    int keep = cx / KILO_RX_CHECKPOINT + 1;
+    if (row -> rx_ck_n > keep) row -> rx_ck_n = keep;
+    row -> ascii_only = -1;
+}
+
+// editorRowGapInsert: Claim the first gap slot at logical index 'at' and
+// return it uninitialized. One gap move instead of shifting the whole table.
+erow *editorRowGapInsert(int at) {
+    editorRowGapGrow();
+    editorRowGapSeek(at);
+    erow *row = &E.row[at];
+    E.row_gap = at + 1;
+    E.numrows++;
+    byteIndexMarkDirty();
+    return row;
+}
+
+// editorInsertRow: Insert a new row at position 'at'
+void editorInsertRow(int at, char *s, size_t len) {
+    if (at < 0 || at > E.numrows) return;
+    erow *row = editorRowGapInsert(at);
+    // Initialize new row
+    row -> size = len;
+    row -> cap = len + 1;
+    row -> chars = malloc(row -> cap);
+    memcpy(row -> chars, s, len);
+    row -> chars[len] = '\0';
+    row -> owns_chars = 1;
+    row -> rsize = 0;
+    row -> render = NULL; // rendered lazily on first display/search
+    row -> render_off = 0;
+    row -> render_eol = 0;
+    row -> hl = NULL;
+    row -> hl_valid = 0;
+    row -> hl_end_state = 0;
+    row -> rx_ck = NULL;
+    row -> rx_ck_n = 0;
+    row -> ascii_only = -1;
+    E.dirty_flag++;
+    journalOp('I', at, 0, row -> chars, len);
+}
+
+// editorAppendRowRef: Append a row whose text points into the mmap'd file
+// (zero-copy). Only used at load time, so it always appends at the end.
+void editorAppendRowRef(char *s, size_t len) {
+    erow *row = editorRowGapInsert(E.numrows);
+    row -> size = len;
+    row -> cap = 0;      // text is borrowed, not owned
+    row -> chars = s;
+    row -> owns_chars = 0;
+    row -> rsize = 0;
+    row -> render = NULL; // rendered lazily on first display/search
+    row -> render_off = 0;
+    row -> render_eol = 0;
+    row -> hl = NULL;
+    row -> hl_valid = 0;
+    row -> hl_end_state = 0;
+    row -> rx_ck = NULL;
+    row -> rx_ck_n = 0;
+    row -> ascii_only = -1;
+}
+
+// editorRowMaterialize: Copy an mmap-backed row into a private heap buffer
+// so it can be edited. No-op for rows that already own their text.
+void editorRowMaterialize(erow *row) {
+    if (row -> owns_chars) return;
+    char *copy = malloc(row -> size + 1);
+    memcpy(copy, row -> chars, row -> size);
+    copy[row -> size] = '\0';
+    row -> chars = copy;
+    row -> cap = row -> size + 1;
+    row -> owns_chars = 1;
+}
+
+void editorFreeRow(erow *row) {
+    free(row -> render);
+    free(row -> hl);
+    free(row -> rx_ck);
+    if (row -> owns_chars) free(row -> chars);
+}
+
+// editorDelRow: Delete a row at position 'at'
+void editorDelRow(int at) {
+    if (at < 0 || at >= E.numrows) return;
+    editorFreeRow(editorRowAt(at));
+    // Absorb the slot into the gap instead of shifting the table
+    editorRowGapSeek(at);
+    E.numrows--;
+    byteIndexMarkDirty();
+    E.dirty_flag++;
+    journalOp('D', at, 0, NULL, 0);
+}
+
+// editorRowReserve: Make sure 'chars' can hold 'need' bytes, doubling on
+// growth so a typing burst into one row costs O(log n) reallocs instead
+// of one per character. Rows never shrink; the slack is reclaimed when
+// the row is freed or rewritten.
+void editorRowReserve(erow *row, int need) {
+    if (row -> cap >= need) return;
+    int cap = row -> cap ? row -> cap : 16;
+    while (cap < need) cap *= 2;
+    row -> chars = realloc(row -> chars, cap);
+    row -> cap = cap;
+}
+
+void editorRowInsertChar(erow *row, int at, int c) {
+    if (at < 0 || at > row -> size) at = row -> size;
+    editorRowMaterialize(row);
+    editorRowReserve(row, row -> size + 2);
+    memmove(&row -> chars[at + 1], &row -> chars[at], row -> size - at + 1);
+    row -> size++;
+    row -> chars[at] = c;
+    byteIndexAdd(editorRowIndex(row), 1);
+    editorRowInvalidateFrom(row, at);
+    E.dirty_flag++;
+    char byte = c;
+    journalOp('i', editorRowIndex(row), at, &byte, 1);
+}
+
+// editorRowInsertString: Splice 'len' bytes into a row at 'at' with one
+// realloc and one memmove, instead of one of each per character
+void editorRowInsertString(erow *row, int at, const char *s, size_t len) {
+    if (at < 0 || at > row -> size) at = row -> size;
+    editorRowMaterialize(row);
+    editorRowReserve(row, row -> size + len + 1);
+    memmove(&row -> chars[at + len], &row -> chars[at], row -> size - at + 1);
+    memcpy(&row -> chars[at], s, len);
+    row -> size += len;
+    byteIndexAdd(editorRowIndex(row), (long long)len);
+    editorRowInvalidateFrom(row, at);
+    E.dirty_flag++;
+    journalOp('R', editorRowIndex(row), 0, row -> chars, row -> size);
+}
+
+void editorRowAppendString(erow *row, char *s, size_t len) {
+    editorRowMaterialize(row);
+    editorRowReserve(row, row -> size + len + 1);
+    int at = row -> size;
+    memcpy(&row -> chars[row -> size], s, len);
+    row -> size += len;
+    row -> chars[row -> size] = '\0';
+    byteIndexAdd(editorRowIndex(row), (long long)len);
+    editorRowInvalidateFrom(row, at);
+    E.dirty_flag++; 
+    journalOp('R', editorRowIndex(row), 0, row -> chars, row -> size);
+}
+
+void editorRowDelChar(erow *row, int at) {
+    if (at < 0 || at >= row -> size) return;
+    editorRowMaterialize(row);
+    memmove(&row -> chars[at], &row -> chars[at + 1], row -> size - at);
+    row -> size--;
+    byteIndexAdd(editorRowIndex(row), -1);
+    editorRowInvalidateFrom(row, at);
+    E.dirty_flag++;
+    journalOp('d', editorRowIndex(row), at, NULL, 0);
+}
+
+// editorRowDeleteSpan: Remove 'len' chars from a row with one memmove
+void editorRowDeleteSpan(int cy, int cx, int len) {
+    erow *row = editorRowAt(cy);
+    if (cx < 0 || len <= 0 || cx + len > row -> size) return;
+    editorRowMaterialize(row);
+    memmove(&row -> chars[cx], &row -> chars[cx + len], row -> size - cx - len + 1);
+    row -> size -= len;
+    byteIndexAdd(cy, -(long long)len);
+    editorRowInvalidateFrom(row, cx);
+    E.dirty_flag++;
+    journalOp('R', cy, 0, row -> chars, row -> size);
+}
+
+// editorRowSplit: Break row 'cy' in two at column 'cx'
+void editorRowSplit(int cy, int cx) {
+    erow *row = editorRowAt(cy);
+    editorRowMaterialize(row);
+    editorInsertRow(cy + 1, &row -> chars[cx], row -> size - cx);
+    row = editorRowAt(cy);
+    row -> size = cx;
+    row -> chars[cx] = '\0';
+    byteIndexMarkDirty();
+    editorRowInvalidateFrom(row, cx);
+    journalOp('R', cy, 0, row -> chars, row -> size);
+}
+
+// editorRowJoin: Append row cy+1's text onto row cy and delete it
+void editorRowJoin(int cy) {
+    erow *lower = editorRowAt(cy + 1);
+    editorRowAppendString(editorRowAt(cy), lower -> chars, lower -> size);
+    editorDelRow(cy + 1);
+}
+
+// * LINE INDEX ----------
+// Fenwick tree over per-row byte lengths (size + 1 for the newline), so
+// "bytes before row i", "row containing byte off" and the status bar's
+// file percentage are O(log n) even on multi-million-line files. Char
+// edits keep the tree exact with point updates; inserting or deleting a
+// whole row shifts every index after it, so structural changes just mark
+// the tree dirty and the next query rebuilds it in one O(n) pass.
+
+// byteIndex: 1-based Fenwick tree; tree[i] covers a[i - (i & -i)..i)
+struct byteIndex {
+    long long *tree;
+    int n;          // rows covered
+    int dirty;      // structural change since the last (re)build
+};
+struct byteIndex BI;
+
+// byteIndexMarkDirty: Row inserted/deleted; rebuild before the next query
+void byteIndexMarkDirty() {
+    BI.dirty = 1;
+}
+
+// byteIndexReady: True when queries are O(log n) right now. Callers that
+// only decorate (the status bar) check this instead of forcing the O(n)
+// rebuild mid-typing; byteIndexEnsure() runs from the idle path or from
+// a query that genuinely needs exact answers (goto).
+int byteIndexReady() {
+    return !BI.dirty && BI.n == E.numrows;
+}
+
+// byteIndexAdd: Row 'at' grew/shrank by 'delta' bytes (O(log n))
+void byteIndexAdd(int at, long long delta) {
+    if (BI.dirty) return;
+    if (at < 0 || at >= BI.n) {
+        BI.dirty = 1;
+        return;
+    }
+    for (int i = at + 1; i <= BI.n; i += i & -i)
+        BI.tree[i] += delta;
+}
+
+// byteIndexEnsure: Rebuild after structural changes, O(n) single pass
+void byteIndexEnsure() {
+    if (!BI.dirty && BI.n == E.numrows) return;
+    BI.n = E.numrows;
+    BI.tree = realloc(BI.tree, sizeof(long long) * (BI.n + 1));
+    memset(BI.tree, 0, sizeof(long long) * (BI.n + 1));
+    for (int i = 1; i <= BI.n; i++) {
+        BI.tree[i] += editorRowAt(i - 1) -> size + 1;
+        int j = i + (i & -i);
+        if (j <= BI.n) BI.tree[j] += BI.tree[i];
+    }
+    BI.dirty = 0;
+}
+
+// byteIndexPrefix: Bytes in rows [0, at)
+long long byteIndexPrefix(int at) {
+    byteIndexEnsure();
+    if (at > BI.n) at = BI.n;
+    long long sum = 0;
+    for (int i = at; i > 0; i -= i & -i)
+        sum += BI.tree[i];
+    return sum;
+}
+
+// byteIndexFindRow: Index of the row containing byte offset 'off'
+int byteIndexFindRow(long long off) {
+    byteIndexEnsure();
+    int pos = 0;
+    int pw = 1;
+    while (pw * 2 <= BI.n) pw *= 2;
+    for (; pw; pw /= 2) {
+        if (pos + pw <= BI.n && BI.tree[pos + pw] <= off) {
+            pos += pw;
+            off -= BI.tree[pos];
+        }
+    }
+    return pos < BI.n ? pos : (BI.n ? BI.n - 1 : 0);
+}
+
+// * SYNTAX HIGHLIGHTING ----------
+// Incremental, lazy lexing. A row's highlight depends only on its render
+// and the multiline-comment state left by the previous row, so each erow
+// caches its end state. Only rows editorDrawRows() actually emits are
+// lexed: editorRowEnsureHighlight() walks back (bounded) to the nearest
+// row with a valid end state and lexes forward from there, and when an
+// edit changes a row's end state only the next row is invalidated --
+// propagation stops as soon as an end state comes out unchanged.
+
+// KILO_HL_SYNC_ROWS: Max backward walk to find a trusted lexer state;
+// beyond this a clean state is assumed (sync point)
+#define KILO_HL_SYNC_ROWS 500
+
+char *C_HL_extensions[] = { ".c", ".h", ".cpp", ".hpp", ".cc", NULL };
+char *C_HL_keywords[] = {
+    "switch", "if", "while", "for", "break", "continue", "return", "else",
+    "struct", "union", "typedef", "static", "enum", "class", "case",
+    "const", "sizeof", "do", "goto",
+    // Types (trailing | marks KEYWORD2)
+    "int|", "long|", "double|", "float|", "char|", "unsigned|", "signed|",
+    "void|", "size_t|", NULL
+};
+
+// HLDB: Supported filetypes
+struct editorSyntax HLDB[] = {
+    {
+        "c",
+        C_HL_extensions,
+        C_HL_keywords,
+        "//", "/*", "*/",
+        HL_HIGHLIGHT_NUMBERS | HL_HIGHLIGHT_STRINGS
+    },
+};
+#define HLDB_ENTRIES (sizeof(HLDB) / sizeof(HLDB[0]))
+
+// is_separator: Token boundary test for keyword/number recognition
+int is_separator(int c) {
+    return isspace(c) || c == '\0' || strchr(",.()+-/*=~%<>[];", c) != NULL;
+}
+
+// editorUpdateSyntax: Lex one row's render given the incoming multiline
+// comment state. Returns 1 if the row's end state changed (the caller
+// then invalidates the next row so the change propagates lazily).
+int editorUpdateSyntax(erow *row, int in_comment) {
+    free(row -> hl);
+    row -> hl = malloc(row -> rsize ? row -> rsize : 1);
+    memset(row -> hl, HL_NORMAL, row -> rsize);
+
+    char **keywords = E.syntax -> keywords;
+    char *scs = E.syntax -> singleline_comment_start;
+    char *mcs = E.syntax -> multiline_comment_start;
+    char *mce = E.syntax -> multiline_comment_end;
+    int scs_len = scs ? strlen(scs) : 0;
+    int mcs_len = mcs ? strlen(mcs) : 0;
+    int mce_len = mce ? strlen(mce) : 0;
+
+    int prev_sep = 1;
+    int in_string = 0;
+    int i = 0;
+    while (i < row -> rsize) {
+        char c = row -> render[i];
+        unsigned char prev_hl = (i > 0) ? row -> hl[i - 1] : HL_NORMAL;
+
+        if (scs_len && !in_string && !in_comment) {
+            if (!strncmp(&row -> render[i], scs, scs_len)) {
+                memset(&row -> hl[i], HL_COMMENT, row -> rsize - i);
+                break;
+            }
+        }
+
+        if (mcs_len && mce_len && !in_string) {
+            if (in_comment) {
+                row -> hl[i] = HL_MLCOMMENT;
+                if (!strncmp(&row -> render[i], mce, mce_len)) {
+                    memset(&row -> hl[i], HL_MLCOMMENT, mce_len);
+                    i += mce_len;
+                    in_comment = 0;
+                    prev_sep = 1;
+                } else {
+                    i++;
+                }
+                continue;
+            } else if (!strncmp(&row -> render[i], mcs, mcs_len)) {
+                memset(&row -> hl[i], HL_MLCOMMENT, mcs_len);
+                i += mcs_len;
+                in_comment = 1;
+                continue;
+            }
+        }
+
+        if (E.syntax -> flags & HL_HIGHLIGHT_STRINGS) {
+            if (in_string) {
+                row -> hl[i] = HL_STRING;
+                if (c == '\\' && i + 1 < row -> rsize) {
+                    row -> hl[i + 1] = HL_STRING;
+                    i += 2;
+                    continue;
+                }
+                if (c == in_string) in_string = 0;
+                i++;
+                prev_sep = 1;
+                continue;
+            } else if (c == '"' || c == '\'') {
+                in_string = c;
+                row -> hl[i] = HL_STRING;
+                i++;
+                continue;
+            }
+        }
+
+        if (E.syntax -> flags & HL_HIGHLIGHT_NUMBERS) {
+            if ((isdigit(c) && (prev_sep || prev_hl == HL_NUMBER)) ||
+                (c == '.' && prev_hl == HL_NUMBER)) {
+                row -> hl[i] = HL_NUMBER;
+                i++;
+                prev_sep = 0;
+                continue;
+            }
+        }
+
+        if (prev_sep) {
+            int j;
+            for (j = 0; keywords[j]; j++) {
+                int klen = strlen(keywords[j]);
+                int kw2 = keywords[j][klen - 1] == '|';
+                if (kw2) klen--;
+                if (!strncmp(&row -> render[i], keywords[j], klen) &&
+                    (i + klen == row -> rsize || is_separator(row -> render[i + klen]))) {
+                    memset(&row -> hl[i], kw2 ? HL_KEYWORD2 : HL_KEYWORD1, klen);
+                    i += klen;
+                    break;
+                }
+            }
+            if (keywords[j] != NULL) {
+                prev_sep = 0;
+                continue;
+            }
+        }
+
+        prev_sep = is_separator(c);
+        i++;
+    }
+
+    int changed = !row -> hl_valid || row -> hl_end_state != in_comment;
+    row -> hl_end_state = in_comment;
+    row -> hl_valid = 1;
+    return changed;
+}
+
+// editorRowEnsureHighlight: Make row 'filerow's highlight valid, lexing
+// forward from the nearest trusted state. Cost is O(window) for normal
+// scrolling; a jump deep into an unlexed file starts from a sync point.
+void editorRowEnsureHighlight(int filerow) {
+    if (E.syntax == NULL) return;
+    erow *row = editorRowAt(filerow);
+    if (row -> hl_valid) return;
+    int start = filerow;
+    while (start > 0 && filerow - start < KILO_HL_SYNC_ROWS) {
+        if (editorRowAt(start - 1) -> hl_valid) break;
+        start--;
+    }
+    int state = (start > 0) ? editorRowAt(start - 1) -> hl_end_state : 0;
+    for (int i = start; i <= filerow; i++) {
+        erow *r = editorRowAt(i);
+        // Window at the displayed column: the draw path just rendered
+        // this row at E.coloff, and re-windowing anywhere else would
+        // throw that render (and the offsets computed against it) away
+        editorRowEnsureRenderWindow(r, E.coloff, E.screencols);
+        int changed = editorUpdateSyntax(r, state);
+        state = r -> hl_end_state;
+        // Propagate an end-state change one row further; stops as soon
+        // as a row's end state is unaffected
+        if (changed && i + 1 < E.numrows)
+            editorRowAt(i + 1) -> hl_valid = 0;
+    }
+}
+
+// editorSyntaxToColor: Highlight class -> ANSI foreground color code
+int editorSyntaxToColor(int hl) {
+    switch (hl) {
+        case HL_COMMENT:
+        case HL_MLCOMMENT: return 36;
+        case HL_KEYWORD1: return 33;
+        case HL_KEYWORD2: return 32;
+        case HL_STRING: return 35;
+        case HL_NUMBER: return 31;
+        default: return 37;
+    }
+}
+
+// editorSelectSyntaxHighlight: Pick HLDB rules from the filename
+void editorSelectSyntaxHighlight() {
+    E.syntax = NULL;
+    if (E.filename == NULL) return;
+    char *ext = strrchr(E.filename, '.');
+    for (unsigned int j = 0; j < HLDB_ENTRIES; j++) {
+        struct editorSyntax *s = &HLDB[j];
+        for (int i = 0; s -> filematch[i]; i++) {
+            int is_ext = (s -> filematch[i][0] == '.');
+            if ((is_ext && ext && !strcmp(ext, s -> filematch[i])) ||
+                (!is_ext && strstr(E.filename, s -> filematch[i]))) {
+                E.syntax = s;
+                return;
+            }
+        }
+    }
+}
+
+// * UNDO ----------
+// Undo/redo built on compact POD operation records. Payloads up to 16
+// bytes (a typed word, after coalescing) live inline in the record;
+// larger deleted text is either referenced in place when the bytes are
+// stable (mmap/arena-backed rows that nothing will free) or copied to
+// the heap once. Adjacent single-character inserts and backspaces merge
+// into the previous record, so 10k keystrokes stay a few hundred KB.
+
+// UNDO_INLINE: Payload bytes stored inside the record itself
+#define UNDO_INLINE 16
+
+enum undoType {
+    U_INSERT,   // 'len' bytes inserted at (cy, cx)
+    U_DELETE,   // 'len' bytes deleted from (cy, cx)
+    U_SPLIT,    // row cy split at column cx
+    U_JOIN      // row cy+1 joined onto row cy at column cx
+};
+
+// undoRecord: One edit. 'text' is NULL when the payload fits inline.
+struct undoRecord {
+    unsigned char type;
+    unsigned char owns;   // 'text' is a private heap copy to free
+    unsigned group;       // nonzero: part of a batch undone as one unit
+    int cy, cx;
+    int len;
+    const char *text;
+    char inline_text[UNDO_INLINE];
+};
+
+struct undoStack {
+    struct undoRecord *recs;
+    int n;
+    int cap;
+};
+struct undoStack undo_stack, redo_stack;
+
+// undo_applying: Suppresses recording while undo/redo mutates the buffer
+int undo_applying;
+
+// undo_group: Group id stamped on records while a batch (region cut,
+// region paste) records; 0 between batches
+unsigned undo_group;
+
+// undoGroupBegin / undoGroupEnd: Bracket a batch of primitives so
+// editorUndo()/editorRedo() replay the whole thing on one keypress
+void undoGroupBegin() {
+    static unsigned next;
+    undo_group = ++next ? next : ++next; // skip 0 on wraparound
+}
+
+void undoGroupEnd() {
+    undo_group = 0;
+}
+
+// undoRecText: Where a record's payload actually lives
+const char *undoRecText(struct undoRecord *r) {
+    return r -> text ? r -> text : r -> inline_text;
+}
+
+// undoStackClear: Drop all records (e.g. redo history after a new edit)
+void undoStackClear(struct undoStack *s) {
+    for (int i = 0; i < s -> n; i++)
+        if (s -> recs[i].owns) free((char *)s -> recs[i].text);
+    s -> n = 0;
+}
+
+// undoStackPush: Append a record, setting up payload storage
+struct undoRecord *undoStackPush(struct undoStack *s, int type, int cy, int cx,
+                                 const char *text, int len, int stable) {
+    if (s -> n == s -> cap) {
+        s -> cap = s -> cap ? s -> cap * 2 : 64;
+        s -> recs = realloc(s -> recs, sizeof(struct undoRecord) * s -> cap);
+    }
+    struct undoRecord *r = &s -> recs[s -> n++];
+    r -> type = type;
+    r -> group = undo_group;
+    r -> cy = cy;
+    r -> cx = cx;
+    r -> len = len;
+    r -> owns = 0;
+    r -> text = NULL;
+    if (len > 0) {
+        if (len <= UNDO_INLINE) {
+            memcpy(r -> inline_text, text, len);
+        } else if (stable) {
+            // Bytes live in the mmap or arena and will never be freed:
+            // reference them instead of copying
+            r -> text = text;
+        } else {
+            char *copy = malloc(len);
+            memcpy(copy, text, len);
+            r -> text = copy;
+            r -> owns = 1;
+        }
+    }
+    return r;
+}
+
+// undoRecActive: Should this mutation be recorded at all?
+int undoRecActive() {
+    return !undo_applying && !journal_replaying;
+}
+
+// undoRecordInsert: Text was inserted at (cy, cx). Single printable
+// characters extend the previous insert record when adjacent.
+void undoRecordInsert(int cy, int cx, const char *text, int len) {
+    if (!undoRecActive()) return;
+    undoStackClear(&redo_stack);
+    if (len == 1 && !isspace((unsigned char)text[0]) && undo_stack.n > 0) {
+        struct undoRecord *top = &undo_stack.recs[undo_stack.n - 1];
+        if (top -> type == U_INSERT && top -> group == undo_group &&
+            top -> cy == cy && top -> cx + top -> len == cx) {
+            // Coalesce into the previous record
+            if (top -> text == NULL && top -> len < UNDO_INLINE) {
+                top -> inline_text[top -> len++] = text[0];
+                return;
+            }
+            if (top -> owns || top -> text == NULL) {
+                char *grown = malloc(top -> len + 1);
+                memcpy(grown, undoRecText(top), top -> len);
+                grown[top -> len] = text[0];
+                if (top -> owns) free((char *)top -> text);
+                top -> text = grown;
+                top -> owns = 1;
+                top -> len++;
+                return;
+            }
+            // Stable-reference payloads can't grow; fall through
+        }
+    }
+    undoStackPush(&undo_stack, U_INSERT, cy, cx, text, len, 0);
+}
+
+// undoRecordDelete: Text was deleted from (cy, cx). Backspace runs
+// prepend onto the previous delete record.
+void undoRecordDelete(int cy, int cx, const char *text, int len, int stable) {
+    if (!undoRecActive()) return;
+    undoStackClear(&redo_stack);
+    if (len == 1 && undo_stack.n > 0) {
+        struct undoRecord *top = &undo_stack.recs[undo_stack.n - 1];
+        if (top -> type == U_DELETE && top -> group == undo_group &&
+            top -> cy == cy && top -> cx == cx + 1 &&
+            top -> text == NULL && top -> len < UNDO_INLINE) {
+            memmove(top -> inline_text + 1, top -> inline_text, top -> len);
+            top -> inline_text[0] = text[0];
+            top -> len++;
+            top -> cx = cx;
+            return;
+        }
+    }
+    undoStackPush(&undo_stack, U_DELETE, cy, cx, text, len, stable);
+}
+
+// undoRecordSplit / undoRecordJoin: Structural row edits
+void undoRecordSplit(int cy, int cx) {
+    if (!undoRecActive()) return;
+    undoStackClear(&redo_stack);
+    undoStackPush(&undo_stack, U_SPLIT, cy, cx, NULL, 0, 0);
+}
+
+void undoRecordJoin(int cy, int cx) {
+    if (!undoRecActive()) return;
+    undoStackClear(&redo_stack);
+    undoStackPush(&undo_stack, U_JOIN, cy, cx, NULL, 0, 0);
+}
+
+// * EDITOR OPERATIONS ----------
+// Functions for editing: insert char, new line, delete char
+
+void editorInsertChar(int c) {
+    if (E.cy == E.numrows) {
+        editorInsertRow(E.numrows, "", 0);
+    }
+    editorRowInsertChar(editorRowAt(E.cy), E.cx, c);
+    char byte = c;
+    undoRecordInsert(E.cy, E.cx, &byte, 1);
+    E.cx++;
+}
+
+void editorInsertNewLine() {
+    undoRecordSplit(E.cy, E.cx);
+    if (E.cx == 0) {
+        editorInsertRow(E.cy, "", 0);
+    } else {
+        editorRowSplit(E.cy, E.cx);
+    }
+    E.cy++;
+    E.cx = 0;
+}
+
+// editorInsertText: Bulk-insert a block of text (possibly many lines) at
+// the cursor. Each row involved is spliced exactly once, so pasting is
+// O(text) instead of O(text * row length) like the per-character path.
+void editorInsertText(const char *s, size_t len) {
+    const char *end = s + len;
+    undoGroupBegin(); // the whole block undoes as one unit
+    while (s < end) {
+        const char *nl = memchr(s, '\n', end - s);
+        size_t seg = nl ? (size_t)(nl - s) : (size_t)(end - s);
+        size_t text_len = seg;
+        if (nl && text_len > 0 && s[text_len - 1] == '\r')
+            text_len--; // CRLF paste
+        if (text_len > 0) {
+            if (E.cy == E.numrows) editorInsertRow(E.numrows, "", 0);
+            editorRowInsertString(editorRowAt(E.cy), E.cx, s, text_len);
+            undoRecordInsert(E.cy, E.cx, s, text_len);
+            E.cx += text_len;
+        }
+        if (nl) editorInsertNewLine();
+        s += seg + (nl ? 1 : 0);
+    }
+    undoGroupEnd();
+}
+
+void editorDelChar() {
+    if (E.cy == E.numrows) return;
+    if (E.cx == 0 && E.cy == 0) return;
+    erow *row = editorRowAt(E.cy);
+    if (E.cx > 0) { 
+        // Back over continuation bytes so a multi-byte sequence goes as
+        // one unit
+        int at = E.cx - 1;
+        if (!editorRowAscii(row))
+            // At most 3 continuation bytes in a valid sequence; malformed
+            // input degrades to byte-at-a-time deletes
+            while (at > 0 && E.cx - at < 4 &&
+                   utf8IsCont((unsigned char)row -> chars[at]))
+                at--;
+        int len = E.cx - at;
+        char bytes[4];
+        memcpy(bytes, &row -> chars[at], len);
+        if (len == 1)
+            editorRowDelChar(row, at);
+        else
+            editorRowDeleteSpan(E.cy, at, len);
+        undoRecordDelete(E.cy, at, bytes, len, 0);
+        E.cx = at;
+    } else {
+        undoRecordJoin(E.cy - 1, editorRowAt(E.cy - 1) -> size);
+        E.cx = editorRowAt(E.cy - 1) -> size;
+        editorRowJoin(E.cy - 1);
+        E.cy--;
+    }
+}
+
+// undoApplyRecord: Apply one record. 'reverse' means undo (invert the
+// recorded edit); otherwise redo (re-apply it). Cursor lands on the edit.
+void undoApplyRecord(struct undoRecord *r, int reverse) {
+    undo_applying = 1;
+    int type = r -> type;
+    // Undo is just redo of the inverse operation
+    if (reverse) {
+        if (type == U_INSERT) type = U_DELETE;
+        else if (type == U_DELETE) type = U_INSERT;
+        else if (type == U_SPLIT) type = U_JOIN;
+        else if (type == U_JOIN) type = U_SPLIT;
+    }
+    switch (type) {
+        case U_DELETE: // remove the recorded span
+            editorRowDeleteSpan(r -> cy, r -> cx, r -> len);
+            E.cy = r -> cy;
+            E.cx = r -> cx;
+            break;
+        case U_INSERT: // put the recorded span back
+            if (E.cy == E.numrows && r -> cy == E.numrows)
+                editorInsertRow(E.numrows, "", 0);
+            editorRowInsertString(editorRowAt(r -> cy), r -> cx, undoRecText(r), r -> len);
+            E.cy = r -> cy;
+            E.cx = r -> cx + r -> len;
+            break;
+        case U_JOIN:
+            editorRowJoin(r -> cy);
+            E.cy = r -> cy;
+            E.cx = r -> cx;
+            break;
+        case U_SPLIT:
+            editorRowSplit(r -> cy, r -> cx);
+            E.cy = r -> cy + 1;
+            E.cx = 0;
+            break;
+    }
+    undo_applying = 0;
+}
+
+// editorUndo / editorRedo: Replay one record - or one whole group -
+// and move it to the other stack
+void editorUndo() {
+    if (undo_stack.n == 0) {
+        editorSetStatusMessage("Nothing to undo");
+        return;
+    }
+    // A grouped batch (region cut/paste) replays as one unit
+    unsigned group = undo_stack.recs[undo_stack.n - 1].group;
+    do {
+        struct undoRecord r = undo_stack.recs[--undo_stack.n];
+        undoApplyRecord(&r, 1);
+        // Transfer the record (and payload ownership) to the redo stack
+        struct undoRecord *moved = undoStackPush(&redo_stack, r.type, r.cy, r.cx, NULL, 0, 0);
+        *moved = r;
+    } while (group && undo_stack.n &&
+             undo_stack.recs[undo_stack.n - 1].group == group);
+}
+
+void editorRedo() {
+    if (redo_stack.n == 0) {
+        editorSetStatusMessage("Nothing to redo");
+        return;
+    }
+    unsigned group = redo_stack.recs[redo_stack.n - 1].group;
+    do {
+        struct undoRecord r = redo_stack.recs[--redo_stack.n];
+        undoApplyRecord(&r, 0);
+        struct undoRecord *moved = undoStackPush(&undo_stack, r.type, r.cy, r.cx, NULL, 0, 0);
+        *moved = r;
+    } while (group && redo_stack.n &&
+             redo_stack.recs[redo_stack.n - 1].group == group);
+}
+
+// * REGION ----------
+// Mark-based region operations (Ctrl-K sets the mark, then copy/cut/
+// paste). Deleting a region is a bulk splice: the two boundary rows get
+// one partial edit each, whole rows in between are absorbed into the row
+// gap in O(1) apiece, and only the boundary rows are re-rendered - a
+// 100k-line block delete is milliseconds, not one editorDelChar() per
+// byte. Undo sees the same region as a forward sequence of primitive
+// records (tail delete, join+delete per row, head delete) whose LIFO
+// inversion rebuilds it; unedited mmap/arena rows are recorded as
+// stable references instead of copies.
+
+// editorMark: Selection anchor; the region runs from here to the cursor
+struct editorMark {
+    int active;
+    int cy, cx;
+};
+struct editorMark MK;
+
+// regionClip: Last copied/cut region, rows separated by newlines
+struct regionClip {
+    char *s;
+    size_t len;
+};
+struct regionClip clip;
+
+// editorRegionBounds: Normalized mark..cursor span; 0 if no mark is set
+int editorRegionBounds(int *scy, int *scx, int *ecy, int *ecx) {
+    if (!MK.active || E.numrows == 0) return 0;
+    int mcy = MK.cy, mcx = MK.cx;
+    int ccy = E.cy, ccx = E.cx;
+    if (mcy >= E.numrows) { mcy = E.numrows - 1; mcx = editorRowAt(mcy) -> size; }
+    if (ccy >= E.numrows) { ccy = E.numrows - 1; ccx = editorRowAt(ccy) -> size; }
+    // Edits since the mark was set may have shrunk either row
+    if (mcx > editorRowAt(mcy) -> size) mcx = editorRowAt(mcy) -> size;
+    if (ccx > editorRowAt(ccy) -> size) ccx = editorRowAt(ccy) -> size;
+    if (mcy > ccy || (mcy == ccy && mcx > ccx)) {
+        *scy = ccy; *scx = ccx;
+        *ecy = mcy; *ecx = mcx;
+    } else {
+        *scy = mcy; *scx = mcx;
+        *ecy = ccy; *ecx = ccx;
+    }
+    if (*scy == *ecy && *scx == *ecx) return 0;
+    return 1;
+}
+
+// editorRegionText: The region's bytes as one heap blob (rows joined
+// with newlines), for the clipboard
+char *editorRegionText(int scy, int scx, int ecy, int ecx, size_t *out_len) {
+    size_t total = 0;
+    for (int i = scy; i <= ecy; i++) {
+        erow *row = editorRowAt(i);
+        int from = (i == scy) ? scx : 0;
+        int to = (i == ecy) ? ecx : row -> size;
+        total += (to - from) + 1; // + newline / NUL
+    }
+    char *buf = malloc(total);
+    char *p = buf;
+    for (int i = scy; i <= ecy; i++) {
+        erow *row = editorRowAt(i);
+        int from = (i == scy) ? scx : 0;
+        int to = (i == ecy) ? ecx : row -> size;
+        memcpy(p, &row -> chars[from], to - from);
+        p += to - from;
+        if (i < ecy) *p++ = '\n';
+    }
+    *out_len = p - buf;
+    return buf;
+}
+
+// editorDeleteRegion: Remove the span with one partial edit per boundary
+// row and O(1) drops for the whole rows between
+void editorDeleteRegion(int scy, int scx, int ecy, int ecx) {
+    if (scy == ecy) {
+        erow *row = editorRowAt(scy);
+        if (ecx > row -> size) ecx = row -> size;
+        if (ecx <= scx) return;
+        if (undoRecActive()) {
+            undoStackClear(&redo_stack);
+            undoStackPush(&undo_stack, U_DELETE, scy, scx,
+                          &row -> chars[scx], ecx - scx, !row -> owns_chars);
+        }
+        editorRowDeleteSpan(scy, scx, ecx - scx);
+    } else {
+        erow *srow = editorRowAt(scy);
+        erow *lrow = editorRowAt(ecy);
+        if (ecx > lrow -> size) ecx = lrow -> size;
+        if (undoRecActive()) {
+            // Record the region as forward primitives; payloads are
+            // captured (or stably referenced) before anything moves
+            undoStackClear(&redo_stack);
+            undoGroupBegin();
+            undoStackPush(&undo_stack, U_DELETE, scy, scx,
+                          &srow -> chars[scx], srow -> size - scx, !srow -> owns_chars);
+            for (int m = scy + 1; m < ecy; m++) {
+                erow *r = editorRowAt(m);
+                undoStackPush(&undo_stack, U_JOIN, scy, scx, NULL, 0, 0);
+                undoStackPush(&undo_stack, U_DELETE, scy, scx,
+                              r -> chars, r -> size, !r -> owns_chars);
+            }
+            undoStackPush(&undo_stack, U_JOIN, scy, scx, NULL, 0, 0);
+            if (ecx > 0)
+                undoStackPush(&undo_stack, U_DELETE, scy, scx,
+                              lrow -> chars, ecx, !lrow -> owns_chars);
+            undoGroupEnd();
+        }
+        editorRowDeleteSpan(scy, scx, srow -> size - scx);
+        if (ecx > 0) editorRowDeleteSpan(ecy, 0, ecx);
+        // The gap sits right after scy, so each drop is O(1)
+        for (int m = scy + 1; m < ecy; m++) editorDelRow(scy + 1);
+        editorRowJoin(scy);
+    }
+    E.cy = scy;
+    E.cx = scx;
+}
+
+// editorRegionCopy / editorRegionCut / editorRegionPaste: the commands
+void editorRegionCopy() {
+    int scy, scx, ecy, ecx;
+    if (!editorRegionBounds(&scy, &scx, &ecy, &ecx)) {
+        editorSetStatusMessage("No region (Ctrl-K sets the mark)");
+        return;
+    }
+    free(clip.s);
+    clip.s = editorRegionText(scy, scx, ecy, ecx, &clip.len);
+    MK.active = 0;
+    editorSetStatusMessage("Copied %zu bytes", clip.len);
+}
+
+void editorRegionCut() {
+    int scy, scx, ecy, ecx;
+    if (!editorRegionBounds(&scy, &scx, &ecy, &ecx)) {
+        editorSetStatusMessage("No region (Ctrl-K sets the mark)");
+        return;
+    }
+    free(clip.s);
+    clip.s = editorRegionText(scy, scx, ecy, ecx, &clip.len);
+    editorDeleteRegion(scy, scx, ecy, ecx);
+    MK.active = 0;
+    editorSetStatusMessage("Cut %zu bytes", clip.len);
+}
+
+void editorRegionPaste() {
+    if (clip.s == NULL) {
+        editorSetStatusMessage("Clipboard is empty");
+        return;
+    }
+    editorInsertText(clip.s, clip.len);
+}
+
+// * BACKGROUND LOADER ----------
+// A background thread scans the mmap'd file for line boundaries and
+// publishes them in batches under a mutex; the main thread drains the
+// batches into the row table between keystrokes. The first screenful is
+// available almost immediately and the row table is only ever mutated on
+// the main thread, so keypresses on already-scanned rows never wait.
+
+// KILO_LOADER_BATCH: Line boundaries published per mutex acquisition
+#define KILO_LOADER_BATCH 4096
+
+// loaderPublish: Hand a batch of scanned boundaries to the main thread
+void loaderPublish(struct loaderLine *batch, int n, size_t scanned, int done) {
+    pthread_mutex_lock(&L.lock);
+    if (L.npending + n > L.pendcap) {
+        if (L.pendcap == 0) L.pendcap = KILO_LOADER_BATCH;
+        while (L.npending + n > L.pendcap) L.pendcap *= 2;
+        L.pending = realloc(L.pending, sizeof(struct loaderLine) * L.pendcap);
+    }
+    memcpy(&L.pending[L.npending], batch, sizeof(struct loaderLine) * n);
+    L.npending += n;
+    L.scanned = scanned;
+    if (done) L.done = 1;
+    pthread_mutex_unlock(&L.lock);
+}
+
+// loaderThread: Scan E.mapped for newlines, batching results
+void *loaderThread(void *arg) {
+    (void)arg;
+    struct loaderLine batch[KILO_LOADER_BATCH];
+    int n = 0;
+    char *p = E.mapped;
+    char *end = E.mapped + E.mapped_len;
+    while (p < end) {
+        char *nl = memchr(p, '\n', end - p);
+        size_t len = nl ? (size_t)(nl - p) : (size_t)(end - p);
+        size_t step = len + (nl ? 1 : 0);
+        if (len > 0 && p[len - 1] == '\r') len--;
+        batch[n].off = p - E.mapped;
+        batch[n].len = len;
+        n++;
+        p += step;
+        if (n == KILO_LOADER_BATCH) {
+            loaderPublish(batch, n, p - E.mapped, 0);
+            n = 0;
+        }
+    }
+    loaderPublish(batch, n, E.mapped_len, 1);
+    return NULL;
+}
+
+// editorLoaderStart: Kick off the background scan of E.mapped
+void editorLoaderStart() {
+    pthread_mutex_init(&L.lock, NULL);
+    L.active = 1;
+    L.done = 0;
+    L.scanned = 0;
+    L.pending = NULL;
+    L.npending = 0;
+    L.pendcap = 0;
+    if (pthread_create(&L.thread, NULL, loaderThread, NULL) != 0)
+        die("pthread_create");
+}
+
+// editorLoaderPoll: Drain published boundaries into the row table.
+// Called from editorRefreshScreen() on the main thread.
+void editorLoaderPoll() {
+    if (!L.active) return;
+    pthread_mutex_lock(&L.lock);
+    struct loaderLine *lines = L.pending;
+    int n = L.npending;
+    int done = L.done;
+    L.pending = NULL;
+    L.npending = 0;
+    L.pendcap = 0;
+    pthread_mutex_unlock(&L.lock);
+    for (int i = 0; i < n; i++)
+        editorAppendRowRef(E.mapped + lines[i].off, lines[i].len);
+    free(lines);
+    if (done) {
+        pthread_join(L.thread, NULL);
+        L.active = 0;
+    }
+    sessionApplyPending();
+}
+
+// editorLoaderProgress: Percent of the file scanned, or -1 when idle
+int editorLoaderProgress() {
+    if (!L.active || E.mapped_len == 0) return -1;
+    pthread_mutex_lock(&L.lock);
+    size_t scanned = L.scanned;
+    pthread_mutex_unlock(&L.lock);
+    return (int)(scanned * 100 / E.mapped_len);
+}
+
+// * JOURNAL ----------
+// Crash-recovery journal: every row-level edit is appended to a sidecar
+// file ("<name>.kilo-journal") as a compact record and fsynced on a
+// timer, so autosave costs O(edit) per keystroke instead of O(file)
+// like a periodic full save. At editorOpen() time a leftover non-empty
+// journal is replayed over the freshly loaded rows; a successful save
+// truncates it.
+
+// KILO_JOURNAL_SYNC_SECS: Max seconds of edits an fsync lag can lose
+#define KILO_JOURNAL_SYNC_SECS 5
+
+// journal_replaying: Suppresses journaling while applying old records
+int journal_replaying;
+
+// journalOp: Append one edit record. Format per record:
+//   <op> <a> <b> <len>\n<len raw bytes>\n
+// ops: 'i' insert char (row a, col b), 'd' delete char (row a, col b),
+//      'I' insert row at a, 'D' delete row a, 'R' replace row a's text
+void journalOp(char op, int a, int b, const char *text, size_t len) {
+    if (E.journal == NULL || journal_replaying) return;
+    static time_t last_sync;
+    fprintf(E.journal, "%c %d %d %zu\n", op, a, b, len);
+    if (len) fwrite(text, 1, len, E.journal);
+    fputc('\n', E.journal);
+    fflush(E.journal);
+    time_t now = time(NULL);
+    if (now - last_sync >= KILO_JOURNAL_SYNC_SECS) {
+        fsync(fileno(E.journal));
+        last_sync = now;
+    }
+}
+
+// journalReplay: Apply every record in 'fp' to the row table.
+// Returns the number of ops applied.
+int journalReplay(FILE *fp) {
+    int ops = 0;
+    char op;
+    int a, b;
+    size_t len;
+    journal_replaying = 1;
+    while (fscanf(fp, " %c %d %d %zu", &op, &a, &b, &len) == 4) {
+        fgetc(fp); // newline after the header
+        char *text = NULL;
+        if (len) {
+            text = malloc(len);
+            if (fread(text, 1, len, fp) != len) {
+                free(text);
+                break;
+            }
+        }
+        fgetc(fp); // newline after the payload
+        switch (op) {
+            case 'i':
+                if (a >= 0 && a < E.numrows && len == 1)
+                    editorRowInsertChar(editorRowAt(a), b, text[0]);
+                break;
+            case 'd':
+                if (a >= 0 && a < E.numrows)
+                    editorRowDelChar(editorRowAt(a), b);
+                break;
+            case 'I':
+                editorInsertRow(a, text ? text : "", len);
+                break;
+            case 'D':
+                editorDelRow(a);
+                break;
+            case 'R':
+                if (a >= 0 && a < E.numrows) {
+                    erow *row = editorRowAt(a);
+                    editorRowMaterialize(row);
+                    editorRowReserve(row, len + 1);
+                    if (len) memcpy(row -> chars, text, len);
+                    row -> chars[len] = '\0';
+                    row -> size = len;
+                    byteIndexMarkDirty();
+                    editorRowInvalidateRender(row);
+                }
+                break;
+        }
+        free(text);
+        ops++;
+    }
+    journal_replaying = 0;
+    return ops;
+}
+
+// editorJournalOpen: Attach the journal for the current file, replaying
+// any records a crashed session left behind
+void editorJournalOpen() {
+    if (E.filename == NULL) return;
+    size_t plen = strlen(E.filename) + sizeof(".kilo-journal");
+    E.journal_path = malloc(plen);
+    snprintf(E.journal_path, plen, "%s.kilo-journal", E.filename);
+    FILE *old_fp = fopen(E.journal_path, "r");
+    if (old_fp) {
+        // Recovery needs the full row table; finish the background load
+        while (L.active) editorLoaderPoll();
+        int ops = journalReplay(old_fp);
+        fclose(old_fp);
+        if (ops > 0) {
+            E.dirty_flag = ops;
+            editorSetStatusMessage("Recovered %d unsaved edit(s) from journal; Ctrl-S to keep", ops);
+        }
+    }
+    E.journal = fopen(E.journal_path, old_fp ? "a" : "w");
+}
+
+// editorJournalTruncate: The file on disk now matches the buffer; start
+// the journal over
+void editorJournalTruncate() {
+    if (E.journal == NULL) return;
+    fflush(E.journal);
+    if (ftruncate(fileno(E.journal), 0) == 0)
+        fseek(E.journal, 0, SEEK_SET);
+}
+
+// * FILE I/O ----------
+// Functions to load and save files
+
+// editorOpenMapped: mmap the file and build rows pointing straight into the
+// mapping. No per-row text copy; rows are materialized on first edit.
+// Returns -1 if the file can't be mapped (empty, not regular, mmap failure)
+// so the caller can fall back to the stdio path.
+int editorOpenMapped(char *filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1) return -1;
+    struct stat st;
+    if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        close(fd);
+        return -1;
+    }
+    char *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+    E.mapped = map;
+    E.mapped_len = st.st_size;
+    // Line boundaries are found by the background loader and drained
+    // into the row table incrementally by editorLoaderPoll()
+    editorLoaderStart();
+    return 0;
+}
+
+void editorOpen(char *filename) {
+    free(E.filename);
+    E.filename = strdup(filename);
+    editorSelectSyntaxHighlight();
+
+    if (editorOpenMapped(filename) == 0) {
+        E.dirty_flag = 0;
+        editorJournalOpen();
+        return;
+    }
+
+    FILE *fp = fopen(filename, "r");
+    if (!fp) die("fopen");
+    char *line = NULL;
+    size_t linecap = 0;
+    ssize_t linelen;
+    while ((linelen = getline(&line, &linecap, fp)) != -1) {
+        while (linelen > 0 && (line[linelen - 1] == '\n' || line[linelen - 1] == '\r'))
+            linelen--;
+        // Row text goes into the arena, not a per-row malloc
+        char *text = editorArenaAlloc(linelen);
+        memcpy(text, line, linelen);
+        editorAppendRowRef(text, linelen);
+    }
+    free(line);
+    fclose(fp);
+    E.dirty_flag = 0;
+    editorJournalOpen();
+}
+
+// Saving happens on a worker thread so keystrokes keep flowing while a
+// large buffer hits the disk. The main thread snapshots the rows as
+// (pointer, length) spans -- mmap- and arena-backed text is referenced
+// in place, only heap-owned rows (the edited ones) are copied -- and the
+// worker streams the spans with writev() into a temp file that is
+// fsync'd and rename()d over the target, so a crash mid-save can never
+// destroy the original. Completion is reported from editorSavePoll().
+
+// KILO_SAVE_IOV: iovec entries per writev() batch; the effective batch
+// is clamped to the kernel's IOV_MAX at save time
+#define KILO_SAVE_IOV 1024
+
+// saveSpan: One row's bytes in the save snapshot
+struct saveSpan {
+    const char *p;
+    size_t len;
+};
+
+// saveState: Worker handoff; 'done' and the result fields are written by
+// the worker and read by editorSavePoll() under 'lock'
+struct saveState {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    int active;           // worker running or result not yet reported
+    int done;
+    int ok;
+    int err;              // errno on failure
+    size_t bytes;         // total bytes written
+    int dirty_at_start;   // E.dirty_flag when the snapshot was taken
+    char *path;
+    char *tmppath;
+    struct saveSpan *spans;
+    int nspans;
+    char *copies;         // private storage backing copied spans
+};
+struct saveState SV;
+
+// saveFlush: writev() a batch to completion, tolerating short writes
+int saveFlush(int fd, struct iovec *iov, int n) {
+    while (n > 0) {
+        ssize_t written = writev(fd, iov, n);
+        if (written == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        while (n > 0 && (size_t)written >= iov[0].iov_len) {
+            written -= iov[0].iov_len;
+            iov++;
+            n--;
+        }
+        if (n > 0) {
+            iov[0].iov_base = (char *)iov[0].iov_base + written;
+            iov[0].iov_len -= written;
+        }
+    }
+    return 0;
+}
+
+// saveThread: Stream the snapshot to the temp file, then rename into place
+void *saveThread(void *arg) {
+    (void)arg;
+    int ok = 0;
+    int fd = mkstemp(SV.tmppath);
+    if (fd != -1) {
+        fchmod(fd, 0644);
+        struct iovec iov[KILO_SAVE_IOV];
+        long batch = sysconf(_SC_IOV_MAX);
+        if (batch <= 0 || batch > KILO_SAVE_IOV) batch = KILO_SAVE_IOV;
+        batch &= ~1L; // two entries per row, keep the cut on a row boundary
+        int n = 0;
+        int failed = 0;
+        for (int i = 0; i < SV.nspans && !failed; i++) {
+            iov[n].iov_base = (char *)SV.spans[i].p;
+            iov[n].iov_len = SV.spans[i].len;
+            n++;
+            iov[n].iov_base = (char *)"\n";
+            iov[n].iov_len = 1;
+            n++;
+            SV.bytes += SV.spans[i].len + 1;
+            if (n == batch) {
+                if (saveFlush(fd, iov, n) == -1) failed = 1;
+                n = 0;
+            }
+        }
+        if (!failed && n > 0 && saveFlush(fd, iov, n) == -1) failed = 1;
+        if (!failed && fsync(fd) == -1) failed = 1;
+        close(fd);
+        if (!failed && rename(SV.tmppath, SV.path) == 0) ok = 1;
+        if (!ok) unlink(SV.tmppath);
+    }
+    pthread_mutex_lock(&SV.lock);
+    SV.ok = ok;
+    SV.err = ok ? 0 : errno;
+    SV.done = 1;
+    pthread_mutex_unlock(&SV.lock);
+    return NULL;
+}
+
+// editorSaveFinish: Join the worker (blocking if it is still writing),
+// report the result, and release the snapshot
+void editorSaveFinish() {
+    pthread_join(SV.thread, NULL);
+    if (SV.ok) {
+        // Only mark clean if nothing was edited while the save ran
+        if (E.dirty_flag == SV.dirty_at_start && E.filename &&
+            strcmp(E.filename, SV.path) == 0) {
+            E.dirty_flag = 0;
+            editorJournalTruncate();
+        }
+        editorSetStatusMessage("%zu bytes written to disk", SV.bytes);
+    } else {
+        editorSetStatusMessage("Cant Save! I/O error: %s", strerror(SV.err));
+    }
+    free(SV.path);
+    free(SV.tmppath);
+    free(SV.spans);
+    free(SV.copies);
+    SV.spans = NULL;
+    SV.copies = NULL;
+    SV.active = 0;
+}
+
+// editorSavePoll: Report a finished save without blocking. Called from
+// editorRefreshScreen() on the main thread.
+void editorSavePoll() {
+    if (!SV.active) return;
+    pthread_mutex_lock(&SV.lock);
+    int done = SV.done;
+    pthread_mutex_unlock(&SV.lock);
+    if (done) editorSaveFinish();
+}
+
+void editorSave() {
+    if (L.active) {
+        editorSetStatusMessage("File still loading (%d%%), can't save yet", editorLoaderProgress());
+        return;
+    }
+    if (SV.active) {
+        editorSetStatusMessage("Save already in progress");
+        return;
+    }
+    if (E.filename == NULL) {
+        E.filename = editorPrompt("Save as: %s (ESC to cancel)", NULL);
+        if (E.filename == NULL) {
+            editorSetStatusMessage("Save aborted");
+            return;
+        }
+        editorSelectSyntaxHighlight();
+    }
+    // Snapshot the rows: reference stable (mmap/arena) text in place,
+    // copy only rows that own their chars and could be edited or freed
+    // while the worker runs
+    size_t copy_bytes = 0;
+    for (int i = 0; i < E.numrows; i++) {
+        erow *row = editorRowAt(i);
+        if (row -> owns_chars) copy_bytes += row -> size;
+    }
+    SV.nspans = E.numrows;
+    SV.spans = malloc(sizeof(struct saveSpan) * (E.numrows ? E.numrows : 1));
+    SV.copies = copy_bytes ? malloc(copy_bytes) : NULL;
+    size_t off = 0;
+    for (int i = 0; i < E.numrows; i++) {
+        erow *row = editorRowAt(i);
+        if (row -> owns_chars) {
+            memcpy(&SV.copies[off], row -> chars, row -> size);
+            SV.spans[i].p = &SV.copies[off];
+            off += row -> size;
+        } else {
+            SV.spans[i].p = row -> chars;
+        }
+        SV.spans[i].len = row -> size;
+    }
+    SV.path = strdup(E.filename);
+    size_t tmplen = strlen(E.filename) + 8;
+    SV.tmppath = malloc(tmplen);
+    snprintf(SV.tmppath, tmplen, "%s.XXXXXX", E.filename);
+    SV.bytes = 0;
+    SV.done = 0;
+    SV.dirty_at_start = E.dirty_flag;
+    pthread_mutex_init(&SV.lock, NULL);
+    SV.active = 1;
+    if (pthread_create(&SV.thread, NULL, saveThread, NULL) != 0) {
+        SV.active = 0;
+        editorSetStatusMessage("Cant Save! pthread_create: %s", strerror(errno));
+        free(SV.path);
+        free(SV.tmppath);
+        free(SV.spans);
+        free(SV.copies);
+        return;
+    }
+    editorSetStatusMessage("Saving %.40s...", E.filename);
+}
+
+// * FOLLOW ----------
+// Read-only tail-follow (like less +F) for watching live logs. The file
+// is watched with inotify; each wakeup reads only the appended byte
+// range, splits it into rows through the arena (no per-row malloc, no
+// re-render of existing rows) and keeps the view pinned to the end.
+// Update cost is proportional to the appended bytes, not the file size.
+
+// followStop: Leave follow mode and drop the watch
+void followStop() {
+    if (!FW.active) return;
+    inotify_rm_watch(FW.ifd, FW.wd);
+    close(FW.ifd);
+    free(FW.carry);
+    FW.carry = NULL;
+    FW.carry_len = 0;
+    FW.active = 0;
+}
+
+// followStart: Begin following E.filename from its current end
+void followStart() {
+    if (E.filename == NULL) {
+        editorSetStatusMessage("No file to follow");
+        return;
+    }
+    if (L.active) {
+        // The loader is still publishing mid-file rows; appending tail
+        // rows now would interleave the buffer out of order
+        editorSetStatusMessage("File still loading, can't follow yet");
+        return;
+    }
+    FW.ifd = inotify_init1(IN_NONBLOCK);
+    if (FW.ifd == -1) {
+        editorSetStatusMessage("Can't follow: inotify_init: %s", strerror(errno));
+        return;
+    }
+    FW.wd = inotify_add_watch(FW.ifd, E.filename, IN_MODIFY);
+    if (FW.wd == -1) {
+        editorSetStatusMessage("Can't follow %s: %s", E.filename, strerror(errno));
+        close(FW.ifd);
+        return;
+    }
+    // Rows loaded so far cover the mapped snapshot (mmap path) or the
+    // file as it was at open; follow picks up from there
+    if (E.mapped) {
+        FW.offset = E.mapped_len;
+    } else {
+        struct stat st;
+        FW.offset = (stat(E.filename, &st) == 0) ? st.st_size : 0;
+    }
+    FW.active = 1;
+    editorSetStatusMessage("Following %s (Ctrl-T to stop, view is read-only)", E.filename);
+}
+
+// followAppend: Turn one chunk of appended bytes into rows, carrying any
+// trailing partial line until its newline shows up
+void followAppend(const char *buf, size_t len) {
+    const char *p = buf;
+    const char *end = buf + len;
+    while (p < end) {
+        const char *nl = memchr(p, '\n', end - p);
+        if (nl == NULL) {
+            FW.carry = realloc(FW.carry, FW.carry_len + (end - p));
+            memcpy(FW.carry + FW.carry_len, p, end - p);
+            FW.carry_len += end - p;
+            break;
+        }
+        size_t linelen = nl - p;
+        if (linelen && nl[-1] == '\r') linelen--;
+        char *text = editorArenaAlloc(FW.carry_len + linelen);
+        memcpy(text, FW.carry, FW.carry_len);
+        memcpy(text + FW.carry_len, p, linelen);
+        editorAppendRowRef(text, FW.carry_len + linelen);
+        FW.carry_len = 0;
+        p = nl + 1;
+    }
+}
+
+// followPoll: Called each refresh; drains inotify and reads the new tail
+void followPoll() {
+    if (!FW.active) return;
+    char events[4096];
+    int modified = 0;
+    ssize_t n;
+    while ((n = read(FW.ifd, events, sizeof(events))) > 0)
+        modified = 1;
+    (void)n;
+    if (!modified) return;
+    struct stat st;
+    if (stat(E.filename, &st) == -1) return;
+    if (st.st_size < FW.offset) {
+        // Truncated or rotated: restart from the new end
+        editorSetStatusMessage("%s truncated, following from new end", E.filename);
+        FW.offset = st.st_size;
+        FW.carry_len = 0;
+        return;
+    }
+    if (st.st_size == FW.offset) return;
+    int fd = open(E.filename, O_RDONLY);
+    if (fd == -1) return;
+    char buf[65536];
+    while (FW.offset < st.st_size) {
+        size_t want = st.st_size - FW.offset;
+        if (want > sizeof(buf)) want = sizeof(buf);
+        ssize_t got = pread(fd, buf, want, FW.offset);
+        if (got <= 0) break;
+        followAppend(buf, got);
+        FW.offset += got;
+    }
+    close(fd);
+    // Pin the view to the tail
+    E.cy = E.numrows ? E.numrows - 1 : 0;
+    E.cx = 0;
+    if (E.numrows > E.screenrows)
+        E.rowoff = E.numrows - E.screenrows;
+}
+
+// * BUFFERS ----------
+// A small fixed set of buffers, each holding the per-file state that
+// used to live only in editorConfig. Switching copies that state in and
+// out of a slot (a dozen scalar fields, O(1)); row storage itself never
+// moves. A global render-cache budget is enforced across buffers: when
+// the cached 'render' arrays exceed it, the least-recently-viewed
+// buffer's renders are freed (they are rebuilt lazily by
+// editorRowEnsureRender() when that buffer is viewed again).
+
+// KILO_MAX_BUFFERS: Buffer slots available
+#define KILO_MAX_BUFFERS 8
+// KILO_RENDER_BUDGET: Default cap on cached render bytes across all
+// buffers; override with the KILO_RENDER_BUDGET environment variable
+#define KILO_RENDER_BUDGET (256 * 1024 * 1024)
+
+// editorBuffer: Per-file state parked while the buffer is not displayed
+struct editorBuffer {
+    int in_use;
+    int cx, cy;
+    int rowoff, coloff;
+    int numrows;
+    erow *row;
+    int rowcap;
+    int row_gap;
+    int dirty_flag;
+    char *filename;
+    char *mapped;
+    size_t mapped_len;
+    struct textSlab *slabs;
+    FILE *journal;
+    char *journal_path;
+    struct editorSyntax *syntax;
+    struct undoStack undo_stack, redo_stack; // history is per-file state
+    unsigned last_viewed;    // LRU tick, bumped on stash
+};
+struct editorBuffer buffers[KILO_MAX_BUFFERS];
+int curbuf;
+unsigned view_tick;
+
+// bufferRowAt: editorRowAt() for a parked buffer's own gap buffer
+erow *bufferRowAt(struct editorBuffer *b, int at) {
+    if (at >= b -> row_gap) at += b -> rowcap - b -> numrows;
+    return &b -> row[at];
+}
+
+// editorBufferStash: Park the current per-file state in its slot
+void editorBufferStash() {
+    struct editorBuffer *b = &buffers[curbuf];
+    b -> in_use = 1;
+    b -> cx = E.cx;
+    b -> cy = E.cy;
+    b -> rowoff = E.rowoff;
+    b -> coloff = E.coloff;
+    b -> numrows = E.numrows;
+    b -> row = E.row;
+    b -> rowcap = E.rowcap;
+    b -> row_gap = E.row_gap;
+    b -> dirty_flag = E.dirty_flag;
+    b -> filename = E.filename;
+    b -> mapped = E.mapped;
+    b -> mapped_len = E.mapped_len;
+    b -> slabs = E.slabs;
+    b -> journal = E.journal;
+    b -> journal_path = E.journal_path;
+    b -> syntax = E.syntax;
+    b -> undo_stack = undo_stack;
+    b -> redo_stack = redo_stack;
+    b -> last_viewed = ++view_tick;
+}
+
+// editorBufferRestore: Make slot 'i' the displayed buffer
+void editorBufferRestore(int i) {
+    struct editorBuffer *b = &buffers[i];
+    E.cx = b -> cx;
+    E.cy = b -> cy;
+    E.rx = 0;
+    E.rowoff = b -> rowoff;
+    E.coloff = b -> coloff;
+    E.numrows = b -> numrows;
+    E.row = b -> row;
+    E.rowcap = b -> rowcap;
+    E.row_gap = b -> row_gap;
+    E.dirty_flag = b -> dirty_flag;
+    E.filename = b -> filename;
+    E.mapped = b -> mapped;
+    E.mapped_len = b -> mapped_len;
+    E.slabs = b -> slabs;
+    E.journal = b -> journal;
+    E.journal_path = b -> journal_path;
+    E.syntax = b -> syntax;
+    undo_stack = b -> undo_stack;
+    redo_stack = b -> redo_stack;
+    MK.active = 0; // mark coordinates belong to the buffer that set it
+    byteIndexMarkDirty();
+    curbuf = i;
+}
+
+// editorBufferReset: Point E at a fresh, empty per-file state
+void editorBufferReset() {
+    E.cx = 0;
+    E.cy = 0;
+    E.rx = 0;
+    E.rowoff = 0;
+    E.coloff = 0;
+    E.numrows = 0;
+    E.row = NULL;
+    E.rowcap = 0;
+    E.row_gap = 0;
+    E.dirty_flag = 0;
+    E.filename = NULL;
+    E.mapped = NULL;
+    E.mapped_len = 0;
+    E.slabs = NULL;
+    E.journal = NULL;
+    E.journal_path = NULL;
+    E.syntax = NULL;
+    // The stashed buffer owns the history that was just parked
+    undo_stack = (struct undoStack){0};
+    redo_stack = (struct undoStack){0};
+    MK.active = 0;
+    byteIndexMarkDirty();
+}
+
+// bufferRenderBytes: Cached render bytes held by a parked buffer
+size_t bufferRenderBytes(struct editorBuffer *b) {
+    size_t bytes = 0;
+    for (int i = 0; i < b -> numrows; i++) {
+        erow *row = bufferRowAt(b, i);
+        if (row -> render) bytes += row -> rsize + 1;
+    }
+    return bytes;
+}
+
+// bufferDropRenders: Free a parked buffer's render cache; rows rebuild
+// their renders lazily when the buffer is next viewed
+void bufferDropRenders(struct editorBuffer *b) {
+    for (int i = 0; i < b -> numrows; i++)
+        editorRowInvalidateRender(bufferRowAt(b, i));
+}
+
+// editorBuffersTrimRenders: Enforce the global render budget by freeing
+// the least-recently-viewed buffers' render caches. Called on buffer
+// switch, so the O(numrows) walks run at human frequency, not per key.
+void editorBuffersTrimRenders() {
+    static long budget = -1;
+    if (budget == -1) {
+        char *env = getenv("KILO_RENDER_BUDGET");
+        budget = env ? atol(env) : KILO_RENDER_BUDGET;
+    }
+    size_t bytes[KILO_MAX_BUFFERS];
+    size_t total = 0;
+    for (int i = 0; i < KILO_MAX_BUFFERS; i++) {
+        bytes[i] = (buffers[i].in_use && i != curbuf) ? bufferRenderBytes(&buffers[i]) : 0;
+        total += bytes[i];
+    }
+    while (total > (size_t)budget) {
+        // Drop the least-recently-viewed buffer still holding renders
+        int victim = -1;
+        for (int i = 0; i < KILO_MAX_BUFFERS; i++) {
+            if (i == curbuf || bytes[i] == 0) continue;
+            if (victim == -1 || buffers[i].last_viewed < buffers[victim].last_viewed)
+                victim = i;
+        }
+        if (victim == -1) break;
+        bufferDropRenders(&buffers[victim]);
+        total -= bytes[victim];
+        bytes[victim] = 0;
+    }
+}
+
+// editorBufferOpen: Open a file (or a new empty file) in a free slot
+void editorBufferOpen() {
+    if (L.active) {
+        editorSetStatusMessage("File still loading, can't open another yet");
+        return;
+    }
+    int slot = -1;
+    for (int i = 0; i < KILO_MAX_BUFFERS; i++) {
+        if (!buffers[i].in_use && i != curbuf) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot == -1) {
+        editorSetStatusMessage("No free buffer slots (%d in use)", KILO_MAX_BUFFERS);
+        return;
+    }
+    char *fname = editorPrompt("Open: %s (ESC to cancel)", NULL);
+    if (fname == NULL) return;
+    followStop();
+    editorBufferStash();
+    editorBufferReset();
+    curbuf = slot;
+    buffers[slot].in_use = 1;
+    if (access(fname, R_OK) == 0) {
+        editorOpen(fname);
+        free(fname);
+    } else {
+        // New file: keep the name, start empty
+        E.filename = fname;
+        editorSelectSyntaxHighlight();
+    }
+    editorBuffersTrimRenders();
+}
+
+// editorBufferNext: Cycle to the next in-use buffer, O(1) state swap
+void editorBufferNext() {
+    if (L.active) {
+        editorSetStatusMessage("File still loading, can't switch yet");
+        return;
+    }
+    for (int step = 1; step < KILO_MAX_BUFFERS; step++) {
+        int i = (curbuf + step) % KILO_MAX_BUFFERS;
+        if (!buffers[i].in_use) continue;
+        followStop();
+        editorBufferStash();
+        editorBufferRestore(i);
+        editorBuffersTrimRenders();
+        editorSetStatusMessage("Buffer %d: %.40s%s", i + 1,
+                               E.filename ? E.filename : "[No Name]",
+                               E.dirty_flag ? " (modified)" : "");
+        return;
+    }
+    editorSetStatusMessage("No other buffers");
+}
+
+// * SESSION ----------
+// Session persistence: cursor and scroll position for every open buffer
+// plus the last search query, written as one fixed-layout struct with a
+// single write() on a clean quit and read back at startup with a single
+// read() plus validation. No text parsing on either side, so getting
+// back to a remembered position in a mmap-loaded multi-gigabyte file is
+// dominated by the open(), not by this.
+
+// KILO_SESSION_MAGIC / _VERSION: reject foreign or stale session files
+#define KILO_SESSION_MAGIC 0x4E53534Bu  // "KSSN"
+#define KILO_SESSION_VERSION 1
+// Session file lives at $KILO_SESSION, or this name under $HOME
+#define KILO_SESSION_NAME ".kilo-session"
+#define KILO_SESSION_NAMEMAX 512
+#define KILO_SESSION_QUERYMAX 128
+
+// sessionBuf: One buffer slot's restorable state
+struct sessionBuf {
+    int in_use;
+    int cx, cy;
+    int rowoff, coloff;
+    char filename[KILO_SESSION_NAMEMAX]; // resolved path; "" if unnamed
+};
+
+// sessionFile: The whole on-disk session, one struct
+struct sessionFile {
+    unsigned magic;
+    unsigned version;
+    unsigned size;      // sizeof(struct sessionFile); guards layout drift
+    int curbuf;
+    char search[KILO_SESSION_QUERYMAX];
+    struct sessionBuf buf[KILO_MAX_BUFFERS];
+};
+
+// Last accepted search query; persisted across sessions
+char session_search[KILO_SESSION_QUERYMAX];
+
+// Remembered position waiting for the background loader to index
+// enough rows to land on it
+static int session_pending = 0;
+static struct sessionBuf session_target;
+
+// sessionPath: $KILO_SESSION if set, else ~/.kilo-session
+static const char *sessionPath() {
+    static char path[KILO_SESSION_NAMEMAX];
+    char *env = getenv("KILO_SESSION");
+    if (env) return env;
+    char *home = getenv("HOME");
+    if (!home) return NULL;
+    snprintf(path, sizeof(path), "%s/%s", home, KILO_SESSION_NAME);
+    return path;
+}
+
+// sessionResolve: Stable identity for a file across runs (and across
+// being opened by different relative paths)
+static void sessionResolve(const char *name, char *out, size_t outsz) {
+    char resolved[PATH_MAX];
+    if (name && realpath(name, resolved))
+        snprintf(out, outsz, "%s", resolved);
+    else
+        snprintf(out, outsz, "%s", name ? name : "");
+}
+
+// sessionSave: Snapshot every in-use buffer (the current one lives in E,
+// parked ones in their slots) and write the struct in one syscall
+void sessionSave() {
+    const char *path = sessionPath();
+    if (path == NULL) return;
+    struct sessionFile s;
+    memset(&s, 0, sizeof(s));
+    s.magic = KILO_SESSION_MAGIC;
+    s.version = KILO_SESSION_VERSION;
+    s.size = sizeof(s);
+    s.curbuf = curbuf;
+    snprintf(s.search, sizeof(s.search), "%s", session_search);
+    for (int i = 0; i < KILO_MAX_BUFFERS; i++) {
+        struct sessionBuf *sb = &s.buf[i];
+        if (i == curbuf) {
+            if (E.filename == NULL) continue;
+            sb -> in_use = 1;
+            sb -> cx = E.cx;
+            sb -> cy = E.cy;
+            sb -> rowoff = E.rowoff;
+            sb -> coloff = E.coloff;
+            sessionResolve(E.filename, sb -> filename, sizeof(sb -> filename));
+        } else if (buffers[i].in_use && buffers[i].filename) {
+            sb -> in_use = 1;
+            sb -> cx = buffers[i].cx;
+            sb -> cy = buffers[i].cy;
+            sb -> rowoff = buffers[i].rowoff;
+            sb -> coloff = buffers[i].coloff;
+            sessionResolve(buffers[i].filename, sb -> filename, sizeof(sb -> filename));
+        }
+    }
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd == -1) return;
+    ssize_t n = write(fd, &s, sizeof(s));
+    close(fd);
+    if (n != (ssize_t)sizeof(s)) unlink(path); // partial session is useless
+}
+
+// sessionApplyPending: Land on the remembered position once enough rows
+// are indexed. With the background loader this runs off each poll, so
+// the jump happens as soon as the target row exists rather than waiting
+// for the whole file.
+void sessionApplyPending() {
+    if (!session_pending) return;
+    if (L.active && E.numrows <= session_target.cy) return;
+    session_pending = 0;
+    E.cy = session_target.cy > E.numrows ? E.numrows : session_target.cy;
+    erow *row = (E.cy < E.numrows) ? editorRowAt(E.cy) : NULL;
+    E.cx = row == NULL ? 0 :
+           session_target.cx > row -> size ? row -> size : session_target.cx;
+    // editorScroll() re-clamps these against the screen each frame
+    E.rowoff = session_target.rowoff;
+    E.coloff = session_target.coloff;
+}
+
+// sessionRestore: Single read() + validation, then jump to the stored
+// position if the session knows the file on the command line
+void sessionRestore() {
+    if (E.filename == NULL) return;
+    const char *path = sessionPath();
+    if (path == NULL) return;
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) return;
+    struct sessionFile s;
+    ssize_t n = read(fd, &s, sizeof(s));
+    close(fd);
+    if (n != (ssize_t)sizeof(s) || s.magic != KILO_SESSION_MAGIC ||
+        s.version != KILO_SESSION_VERSION || s.size != sizeof(s))
+        return;
+    snprintf(session_search, sizeof(session_search), "%s", s.search);
+    char name[KILO_SESSION_NAMEMAX];
+    sessionResolve(E.filename, name, sizeof(name));
+    for (int i = 0; i < KILO_MAX_BUFFERS; i++) {
+        if (!s.buf[i].in_use || strcmp(s.buf[i].filename, name) != 0)
+            continue;
+        session_target = s.buf[i];
+        session_pending = 1;
+        sessionApplyPending();
+        break;
+    }
+}
+
+// * FIND ----------
+// Incremental search. Instead of re-scanning every row with strstr() on
+// each prompt keystroke, a match list is built once per query with
+// memmem() (Horspool-class substring matching in libc) and kept for the
+// lifetime of the prompt. Extending the query can only narrow the
+// previous matches, so those keystrokes just filter the existing list,
+// and ARROW navigation indexes into it without any re-scan.
+
+// searchMatch: One hit, as row index plus offset into that row's render
+struct searchMatch {
+    int row;
+    int rx;
+};
+
+// searchState: Match list for the query currently in the prompt
+struct searchState {
+    char *query;                 // query the list was built for
+    struct searchMatch *matches;
+    int nmatches;
+    int matchcap;
+    int current;                 // list index the cursor is parked on
+    int regex;                   // prompt is in regex mode (Ctrl-R)
+};
+struct searchState SS;
+
+// Compiled-pattern cache: one regcomp per distinct pattern, reused
+// across the prompt's callback keystrokes instead of per keystroke
+static regex_t search_re;
+static int search_re_valid;
+static char *search_re_pat;
+
+// searchRegexEnsure: Compile 'pat' into the cache unless it already
+// holds that pattern. Returns -1 for invalid patterns, which are normal
+// while one is being typed; callers just show zero matches.
+int searchRegexEnsure(const char *pat) {
+    if (search_re_valid && strcmp(search_re_pat, pat) == 0) return 0;
+    if (search_re_valid) {
+        regfree(&search_re);
+        search_re_valid = 0;
+    }
+    if (regcomp(&search_re, pat, REG_EXTENDED) != 0) return -1;
+    free(search_re_pat);
+    search_re_pat = strdup(pat);
+    search_re_valid = 1;
+    return 0;
+}
+
+// searchRegexLiteral: Longest literal run the pattern requires in every
+// match, used to prefilter rows with memmem() before paying for
+// regexec(). Deliberately conservative: only runs outside any group
+// count, since a group can turn out to be quantified away ("(foo)?bar"
+// doesn't require "foo"); top-level alternation means nothing at all is
+// required (prefilter off; inside a group it only ends a run that was
+// being ignored anyway); an atom followed by *, ? or { is optional and
+// ends the run without it; classes and anchors just break the run.
+// Returns the literal's length, 0 for no prefilter.
+int searchRegexLiteral(const char *pat, char *out, int outsz) {
+    char run[256];
+    int rlen = 0, best = 0;
+    int depth = 0; // group nesting; runs at depth > 0 aren't required
+    for (const char *p = pat; ; p++) {
+        char c = *p;
+        int literal = 0;
+        if (c == '|' && depth == 0) return 0;
+        if (c == '\\' && p[1]) {
+            // Escaped metachars are literal; escape classes (\w etc.) aren't
+            if (!isalnum((unsigned char)p[1])) {
+                literal = p[1];
+                p++;
+            }
+        } else if (c != '\0' && strchr(".*+?[](){}^$|", c) == NULL) {
+            literal = c;
+        }
+        if (literal) {
+            // A following *, ? or { makes this atom optional
+            if (p[1] == '*' || p[1] == '?' || p[1] == '{') {
+                literal = 0;
+            } else if (rlen < (int)sizeof(run)) {
+                run[rlen++] = literal;
+                // '+' repeats the atom, so the run can't extend past it
+                if (p[1] == '+') literal = 0;
+            }
+        }
+        if (!literal || c == '\0') {
+            if (depth == 0 && rlen > best && rlen <= outsz) {
+                best = rlen;
+                memcpy(out, run, rlen);
+            }
+            rlen = 0;
+        }
+        if (c == '\0') break;
+        if (c == '(') {
+            depth++;
+        } else if (c == ')') {
+            if (depth > 0) depth--;
+        } else if (c == '[') {
+            // Skip the class body; ']' is literal right after '[' or '[^'
+            p++;
+            if (*p == '^') p++;
+            if (*p == ']') p++;
+            while (*p && *p != ']') p++;
+            if (!*p) break;
+        } else if (c == '{') {
+            // Repetition counts aren't text to match
+            while (*p && *p != '}') p++;
+            if (!*p) break;
+        }
+    }
+    return best;
+}
+
+// editorSearchFree: Drop the match list when the prompt ends
+void editorSearchFree() {
+    free(SS.query);
+    free(SS.matches);
+    SS.query = NULL;
+    SS.matches = NULL;
+    SS.nmatches = 0;
+    SS.matchcap = 0;
+    SS.current = 0;
+}
+
+// KILO_SEARCH_PAR_MIN: Buffers below this many rows are scanned on the
+// calling thread; the fork/join overhead only pays off past it
+#define KILO_SEARCH_PAR_MIN 20000
+// KILO_SEARCH_THREADS: Upper bound on search workers
+#define KILO_SEARCH_THREADS 16
+
+// searchJob: One worker's contiguous row range and its private results;
+// ranges never overlap, so workers touch disjoint rows and need no locks
+struct searchJob {
+    int lo, hi;
+    const char *query;
+    size_t qlen;
+    regex_t *re;                 // non-NULL selects regex matching
+    const char *lit;             // required-literal prefilter ("" = none)
+    size_t lit_len;
+    struct searchMatch *matches;
+    int n, cap;
+};
+
+// searchJobPush: Append one match to a job's private list
+void searchJobPush(struct searchJob *job, int row, int rx) {
+    if (job -> n == job -> cap) {
+        job -> cap = job -> cap ? job -> cap * 2 : 64;
+        job -> matches = realloc(job -> matches, sizeof(struct searchMatch) * job -> cap);
+    }
+    job -> matches[job -> n].row = row;
+    job -> matches[job -> n].rx = rx;
+    job -> n++;
+}
+
+// searchScanRow: Find every match in one row. Monster rows are scanned
+// as raw text (see the windowed-render notes); normal rows through their
+// render so tabs match as the spaces the user sees.
+void searchScanRow(struct searchJob *job, int filerow) {
+    erow *row = editorRowAt(filerow);
+    if (row -> size >= KILO_RENDER_WINDOW) {
+        char *p = row -> chars;
+        char *end = row -> chars + row -> size;
+        while ((size_t)(end - p) >= job -> qlen) {
+            char *m = memmem(p, end - p, job -> query, job -> qlen);
+            if (!m) break;
+            searchJobPush(job, filerow, editorRowCxToRx(row, m - row -> chars));
+            p = m + 1;
+        }
+        return;
+    }
+    // Render directly: workers own disjoint rows, so the mutation is safe
+    if (row -> render == NULL) editorUpdateRow(row);
+    char *p = row -> render;
+    char *end = row -> render + row -> rsize;
+    while ((size_t)(end - p) >= job -> qlen) {
+        char *m = memmem(p, end - p, job -> query, job -> qlen);
+        if (!m) break;
+        // Matches are stored as display columns, which only differ from
+        // byte offsets on rows with multi-byte characters
+        searchJobPush(job, filerow,
+                      editorRowRenderByteToCol(row, m - row -> render));
+        p = m + 1;
+    }
+}
+
+// searchScanRowRegex: Regex matching over one row, prefiltered: rows
+// that don't contain the pattern's required literal are rejected at
+// memmem() speed and never reach regexec(). REG_STARTEND scopes the
+// match to the row text without needing a terminator.
+void searchScanRowRegex(struct searchJob *job, int filerow) {
+    erow *row = editorRowAt(filerow);
+    int monster = row -> size >= KILO_RENDER_WINDOW;
+    char *text;
+    int len;
+    if (monster) {
+        text = row -> chars;
+        len = row -> size;
+    } else {
+        if (row -> render == NULL) editorUpdateRow(row);
+        text = row -> render;
+        len = row -> rsize;
+    }
+    if (job -> lit_len && memmem(text, len, job -> lit, job -> lit_len) == NULL)
+        return;
+    int off = 0;
+    while (off <= len) {
+        regmatch_t pm;
+        pm.rm_so = 0;
+        pm.rm_eo = len - off;
+        if (regexec(job -> re, text + off, 1, &pm,
+                    REG_STARTEND | (off ? REG_NOTBOL : 0)))
+            break;
+        int so = off + pm.rm_so;
+        int eo = off + pm.rm_eo;
+        searchJobPush(job, filerow,
+                      monster ? editorRowCxToRx(row, so)
+                              : editorRowRenderByteToCol(row, so));
+        off = eo > so ? eo : so + 1; // never stall on an empty match
+    }
+}
+
+// searchThread: Worker entry; scans the job's row range
+void *searchThread(void *arg) {
+    struct searchJob *job = arg;
+    for (int i = job -> lo; i < job -> hi; i++) {
+        if (job -> re)
+            searchScanRowRegex(job, i);
+        else
+            searchScanRow(job, i);
+    }
+    return NULL;
+}
+
+// editorSearchScanAll: Full-buffer scan into SS, fanning out across
+// cores for big buffers. Jobs are merged back in row order, so the
+// match list reads exactly as the serial scan would produce it.
+void editorSearchScanAll(const char *query, size_t qlen) {
+    int nthreads = 1;
+    if (E.numrows >= KILO_SEARCH_PAR_MIN) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        if (cores > 1) nthreads = cores < KILO_SEARCH_THREADS ? (int)cores : KILO_SEARCH_THREADS;
+    }
+    struct searchJob jobs[KILO_SEARCH_THREADS] = {0};
+    regex_t worker_re[KILO_SEARCH_THREADS];
+    pthread_t threads[KILO_SEARCH_THREADS];
+    char lit[256];
+    int lit_len = 0;
+    if (SS.regex) lit_len = searchRegexLiteral(query, lit, sizeof(lit));
+    int per = E.numrows / nthreads + 1;
+    for (int t = 0; t < nthreads; t++) {
+        jobs[t].lo = t * per;
+        jobs[t].hi = (t + 1) * per < E.numrows ? (t + 1) * per : E.numrows;
+        jobs[t].query = query;
+        jobs[t].qlen = qlen;
+        if (SS.regex) {
+            // Workers get private compiles: POSIX doesn't promise that
+            // one regex_t can be executed from several threads at once.
+            // The caller already validated the pattern via the cache.
+            if (nthreads == 1) {
+                jobs[t].re = &search_re;
+            } else {
+                regcomp(&worker_re[t], query, REG_EXTENDED);
+                jobs[t].re = &worker_re[t];
+            }
+            jobs[t].lit = lit;
+            jobs[t].lit_len = lit_len;
+        }
+    }
+    if (nthreads == 1) {
+        searchThread(&jobs[0]);
+    } else {
+        // The row gap must not move while workers index the table
+        editorRowGapSeek(E.numrows);
+        for (int t = 0; t < nthreads; t++)
+            pthread_create(&threads[t], NULL, searchThread, &jobs[t]);
+        for (int t = 0; t < nthreads; t++)
+            pthread_join(threads[t], NULL);
+        if (SS.regex)
+            for (int t = 0; t < nthreads; t++) regfree(&worker_re[t]);
+    }
+    int total = 0;
+    for (int t = 0; t < nthreads; t++) total += jobs[t].n;
+    if (total > SS.matchcap) {
+        SS.matchcap = total;
+        SS.matches = realloc(SS.matches, sizeof(struct searchMatch) * SS.matchcap);
+    }
+    SS.nmatches = 0;
+    for (int t = 0; t < nthreads; t++) {
+        if (jobs[t].n) {
+            memcpy(&SS.matches[SS.nmatches], jobs[t].matches,
+                   sizeof(struct searchMatch) * jobs[t].n);
+            SS.nmatches += jobs[t].n;
+        }
+        free(jobs[t].matches);
+    }
+}
+
+// editorSearchBuild: (Re)build the match list for 'query'. If the new
+// query extends the previous one, filter the existing matches instead of
+// scanning the whole buffer again.
+void editorSearchBuild(char *query) {
+    size_t qlen = strlen(query);
+    if (SS.regex) {
+        // Extending a regex doesn't narrow its matches, so there's no
+        // filter shortcut; the compile is cached, the scan is not
+        if (searchRegexEnsure(query) != 0)
+            SS.nmatches = 0; // invalid (likely mid-typing): no matches
+        else
+            editorSearchScanAll(query, qlen);
+    } else if (SS.query && qlen >= strlen(SS.query) &&
+        strncmp(query, SS.query, strlen(SS.query)) == 0) {
+        // Query extension: every new match starts at an old match
+        int n = 0;
+        for (int i = 0; i < SS.nmatches; i++) {
+            erow *row = editorRowAt(SS.matches[i].row);
+            int rx = SS.matches[i].rx;
+            if (row -> size >= KILO_RENDER_WINDOW) {
+                // Windowed rows are matched against the raw text
+                int cx = editorRowRxToCx(row, rx);
+                if (cx + (int)qlen <= row -> size &&
+                    memcmp(&row -> chars[cx], query, qlen) == 0)
+                    SS.matches[n++] = SS.matches[i];
+                continue;
+            }
+            editorRowEnsureRender(row);
+            int b = editorRowRenderColToByte(row, rx);
+            if (b + (int)qlen <= row -> rsize &&
+                memcmp(&row -> render[b], query, qlen) == 0)
+                SS.matches[n++] = SS.matches[i];
+        }
+        SS.nmatches = n;
+    } else {
+        editorSearchScanAll(query, qlen);
+    }
+    free(SS.query);
+    SS.query = strdup(query);
+}
+
+// editorFindStep: One step of an interactive search (see the callback)
+void editorFindStep(char *query, int key) {
+    // The prompt is done: drop the match list
+    if (key == '\r' || key == '\x1b') {
+        editorSearchFree();
+        return;
+    }
+    int dir = 0;
+    if (key == ARROW_RIGHT || key == ARROW_DOWN) {
+        dir = 1;
+    } else if (key == ARROW_LEFT || key == ARROW_UP) {
+        dir = -1;
+    } else {
+        // Query changed: rebuild (or narrow) the match list and park on
+        // the first match at or after the cursor
+        if (query[0] == '\0') {
+            editorSearchFree();
+            return;
+        }
+        editorSearchBuild(query);
+        SS.current = 0;
+        for (int i = 0; i < SS.nmatches; i++) {
+            if (SS.matches[i].row >= E.cy) {
+                SS.current = i;
+                break;
+            }
+        }
+    }
+    if (SS.nmatches == 0) return;
+    if (dir) SS.current = (SS.current + dir + SS.nmatches) % SS.nmatches;
+    struct searchMatch *m = &SS.matches[SS.current];
+    erow *row = editorRowAt(m -> row);
+    E.cy = m -> row;
+    E.cx = editorRowRxToCx(row, m -> rx);
+    E.rowoff = E.numrows;
+}
+
+// editorFindCallback: Prompt callback; times each interactive step so
+// find latency shows up in the perf histograms
+void editorFindCallback(char *query, int key) {
+    long long t0 = perfNow();
+    editorFindStep(query, key);
+    perfRecord(PERF_FIND, perfNow() - t0);
+}
+
+// editorFindInternal: Prompt driver shared by both search modes
+void editorFindInternal(int regex) {
+    int saved_cx = E.cx;
+    int saved_cy = E.cy;
+    int saved_coloff = E.coloff;
+    int saved_rowoff = E.rowoff;
+
+    SS.regex = regex;
+    char *query = editorPrompt(regex ? "Regex: %s (USE ESC/Arrows/Enter)"
+                                     : "Search: %s (USE ESC/Arrows/Enter)",
+                               editorFindCallback);
+    SS.regex = 0;
+    if (query) {
+        snprintf(session_search, sizeof(session_search), "%s", query);
+        free(query);
+    } else {
+        E.cx = saved_cx;
+        E.cy = saved_cy;
+        E.coloff = saved_coloff;
+        E.rowoff = saved_rowoff;
+    }
+}
+
+void editorFind() {
+    editorFindInternal(0);
+}
+
+// editorFindRegex: Ctrl-R; same incremental prompt, POSIX extended
+// regex matching with a literal prefilter
+void editorFindRegex() {
+    editorFindInternal(1);
+}
+
+// * APPEND BUFFER ----------
+// abuf: Dynamic string buffer for efficient screen drawing.
+// Appends land in the inline 'stack' array until it is outgrown, so the
+// damage-tracked steady-state frame (a row or two) never touches the
+// heap; larger frames grow capacity geometrically instead of one
+// realloc per append.
+
+// ABUF_INLINE: Bytes of inline storage before spilling to the heap
+#define ABUF_INLINE 512
+
+struct abuf {
+    char *b;
+    int len;
+    int cap;
+    char stack[ABUF_INLINE];
+};
+#define ABUF_INIT {NULL, 0, 0, {0}}
+
+// abReserve: Ensure capacity for at least 'cap' bytes in total
+void abReserve(struct abuf *ab, int cap) {
+    if (ab->b == NULL) {
+        ab->b = ab->stack;
+        ab->cap = ABUF_INLINE;
+    }
+    if (cap <= ab->cap) return;
+    int newcap = ab->cap * 2;
+    if (newcap < cap) newcap = cap;
+    if (ab->b == ab->stack) {
+        char *heap = malloc(newcap);
+        if (heap == NULL) return;
+        memcpy(heap, ab->stack, ab->len);
+        ab->b = heap;
+    } else {
+        char *heap = realloc(ab->b, newcap);
+        if (heap == NULL) return;
+        ab->b = heap;
+    }
+    ab->cap = newcap;
+}
+
+// abAppend: Append string to abuf
+void abAppend(struct abuf *ab, const char *s, int len) {
+    abReserve(ab, ab->len + len);
+    if (ab->len + len > ab->cap) return; // allocation failed
+    memcpy(&ab->b[ab->len], s, len);
+    ab->len += len;
+}
+// abFree: Free abuf memory (no-op while still on the inline buffer)
+void abFree(struct abuf *ab) {
+    if (ab->b != ab->stack) free(ab->b);
+}
+
+// * OUTPUT ----------
+// Functions to draw rows, status bar, message bar, and refresh the screen
+
+// frameShadow: Copy of the last frame actually sent to the terminal, one
+// entry per terminal row. editorEmitLine() diffs against it and only
+// emits rows that changed, so a plain keystroke repaints one row instead
+// of the whole screen.
+struct frameShadow {
+    char **line;
+    int *len;
+    int *color;    // SGR foreground in effect when the line was emitted
+    int rows;
+};
+struct frameShadow shadow;
+
+// emit_color: The foreground color the terminal is currently set to,
+// tracked across rows and frames so editorEmitLine() only re-emits a
+// line when its bytes or the color state it was drawn under changed.
+// -1 means the default foreground.
+int emit_color = -1;
+
+// editorShadowResize: (Re)allocate the shadow for 'rows' terminal rows
+void editorShadowResize(int rows) {
+    for (int i = 0; i < shadow.rows; i++) free(shadow.line[i]);
+    free(shadow.line);
+    free(shadow.len);
+    free(shadow.color);
+    shadow.line = calloc(rows, sizeof(char *));
+    shadow.len = calloc(rows, sizeof(int));
+    shadow.color = calloc(rows, sizeof(int));
+    shadow.rows = rows;
+    emit_color = -1;
+}
+
+// editorShadowInvalidate: Force every row to be re-emitted next frame
+void editorShadowInvalidate() {
+    for (int i = 0; i < shadow.rows; i++) {
+        free(shadow.line[i]);
+        shadow.line[i] = NULL;
+        shadow.len[i] = 0;
+    }
+}
+
+// editorEmitLine: Emit content for 1-based terminal row 'line' if it
+// differs from what that row currently shows, updating the shadow. A
+// line is only skipped when both its bytes and the color state it was
+// drawn under match; either way emit_color advances to 'end_color', the
+// foreground its bytes leave the terminal in.
+void editorEmitLine(struct abuf *ab, int line, const char *s, int len, int end_color) {
+    int i = line - 1;
+    if (i >= shadow.rows) return;
+    if (shadow.line[i] && shadow.len[i] == len && shadow.color[i] == emit_color &&
+        memcmp(shadow.line[i], s, len) == 0) {
+        emit_color = end_color;
+        return;
+    }
+    shadow.line[i] = realloc(shadow.line[i], len);
+    memcpy(shadow.line[i], s, len);
+    shadow.len[i] = len;
+    shadow.color[i] = emit_color;
+    emit_color = end_color;
+    char buf[16];
+    abAppend(ab, buf, snprintf(buf, sizeof(buf), "\x1b[%d;1H", line));
+    abAppend(ab, s, len);
+}
+
+void editorScroll() {
+    E.rx = 0;
+    if (E.cy < E.numrows) {
+        E.rx = editorRowCxToRx(editorRowAt(E.cy), E.cx);
+    }
+    if (E.cy < E.rowoff) {
+        E.rowoff = E.cy;
+    }
+    if (E.cy >= E.rowoff + E.screenrows) {
+        E.rowoff = E.cy - E.screenrows + 1;
+    }
+    if (E.rx < E.coloff) {
+        E.coloff = E.rx;
+    }
+    if (E.rx >= E.coloff + E.screencols) {
+        E.coloff = E.rx - E.screencols + 1;
+    }
+}
+
+void editorDrawRows(struct abuf *ab) {
+    struct abuf scratch = ABUF_INIT;
+    // Pre-size for the widest possible row so wide terminals don't grow
+    // the scratch buffer mid-frame
+    abReserve(&scratch, E.screencols + 16);
+    for (int y = 0; y < E.screenrows; y++) {
+        scratch.len = 0; // Reuse the scratch buffer across rows
+        int run_color = emit_color;
+        int filerow = y + E.rowoff;
+        if (filerow >= E.numrows) {
+            if (run_color != -1) {
+                abAppend(&scratch, "\x1b[39m", 5);
+                run_color = -1;
+            }
+            if (E.numrows == 0 && y == E.screenrows / 3) {
+                char welcome[80];
+                int welcomelen = snprintf(welcome, sizeof(welcome),
+                "Kilo editor -- version %s", KILO_VERSION);
+                if (welcomelen > E.screencols) welcomelen = E.screencols;
+                int padding = (E.screencols - welcomelen) / 2;
+                if (padding) {
+                    abAppend(&scratch, "~", 1);
+                    padding--;
+                }
+                while (padding--) abAppend(&scratch, " ", 1);
+                abAppend(&scratch, welcome, welcomelen);
+            } else {
+            abAppend(&scratch, "~", 1);
+            }
+        } else {
+            erow *row = editorRowAt(filerow);
+            editorRowEnsureRenderWindow(row, E.coloff, E.screencols);
+            int off = E.coloff - row -> render_off; // 0-based into the window
+            int len = editorRowRenderCols(row) - off;
+            if (len < 0) len = 0;
+            if (len > E.screencols) len = E.screencols;
+            // Columns sized the slice; bytes address it (multi-byte
+            // sequences are wider in the buffer than on screen)
+            int off_b = editorRowRenderColToByte(row, off);
+            int len_b = editorRowRenderColToByte(row, off + len) - off_b;
+            if (E.syntax == NULL) {
+                if (run_color != -1) {
+                    abAppend(&scratch, "\x1b[39m", 5);
+                    run_color = -1;
+                }
+                abAppend(&scratch, &row -> render[off_b], len_b);
+            } else {
+                // Emit SGR codes only at color-run boundaries; runs carry
+                // across row ends (and the \x1b[K clears, which don't
+                // touch the foreground), so an unbroken comment block
+                // costs one escape no matter how many rows it spans
+                editorRowEnsureHighlight(filerow);
+                char *text = &row -> render[off_b];
+                unsigned char *hl = &row -> hl[off_b];
+                int i = 0;
+                while (i < len_b) {
+                    int j = i;
+                    while (j < len_b && hl[j] == hl[i]) j++;
+                    int color = (hl[i] == HL_NORMAL) ? -1 : editorSyntaxToColor(hl[i]);
+                    if (color != run_color) {
+                        char cbuf[16];
+                        int clen = snprintf(cbuf, sizeof(cbuf), "\x1b[%dm",
+                                            color == -1 ? 39 : color);
+                        abAppend(&scratch, cbuf, clen);
+                        run_color = color;
+                    }
+                    abAppend(&scratch, text + i, j - i);
+                    i = j;
+                }
+            }
+        }
+        abAppend(&scratch, "\x1b[K", 3);
+        editorEmitLine(ab, y + 1, scratch.b, scratch.len, run_color);
+    }
+    abFree(&scratch);
+}
+
+void editorDrawStatusBar(struct abuf *ab) {
+    struct abuf scratch = ABUF_INIT;
+    if (emit_color != -1) abAppend(&scratch, "\x1b[39m", 5);
+    abAppend(&scratch, "\x1b[7m", 4);  // Inverted colors
+
+    char status[80], rstatus[80];
+    int progress = editorLoaderProgress();
+    int len;
+    if (progress >= 0) {
+        len = snprintf(status, sizeof(status), "%.20s - %d lines (loading %d%%)",
+                       E.filename ? E.filename : "[No Name]", E.numrows, progress);
+    } else {
+        len = snprintf(status, sizeof(status), "%.20s - %d lines %s",
+                       E.filename ? E.filename : "[No Name]", E.numrows,
+                       FW.active ? "(following)" : E.dirty_flag ? "(modified)" : "");
+    }
+    int rlen;
+    if (perf_visible) {
+        // Live latency digest (Ctrl-P): frame times and the felt
+        // keystroke-to-frame number, from the perf histograms
+        rlen = snprintf(rstatus, sizeof(rstatus),
+                        "rf %.1f/%.1fms k2f p99 %.1fms",
+                        perfPercentile(PERF_REFRESH, 50) / 1e6,
+                        perfPercentile(PERF_REFRESH, 99) / 1e6,
+                        perfPercentile(PERF_K2F, 99) / 1e6);
+    } else if (E.numrows && !L.active) {
+        // Byte-accurate position via the line index when it's current;
+        // while it's dirty (structural edit this keystroke) reuse the
+        // last percentage rather than paying the O(n) rebuild per frame
+        static long long last_pct;
+        if (byteIndexReady()) {
+            long long total = byteIndexPrefix(E.numrows);
+            long long off = byteIndexPrefix(E.cy) + E.cx;
+            last_pct = total ? off * 100 / total : 0;
+        }
+        rlen = snprintf(rstatus, sizeof(rstatus), "%d/%d %lld%%", E.cy + 1,
+                        E.numrows, last_pct);
+    } else {
+        rlen = snprintf(rstatus, sizeof(rstatus), "%d/%d", E.cy + 1, E.numrows);
+    }
+    
+    if (len > E.screencols) len = E.screencols;
+    abAppend(&scratch, status, len);
+
+    while (len < E.screencols) {  // Fixed: E.screencols instead of E.screenrows
+        if (E.screencols - len == rlen) {
+            abAppend(&scratch, rstatus, rlen);
+            break;
+        } else {
+            abAppend(&scratch, " ", 1);
+            len++;
+        }
+    }
+
+    abAppend(&scratch, "\x1b[m", 3);  // Restore normal formatting
+    editorEmitLine(ab, E.screenrows + 1, scratch.b, scratch.len, -1);
+    abFree(&scratch);
+}
+
+void editorDrawMessageBar(struct abuf *ab) {
+    struct abuf scratch = ABUF_INIT;
+    abAppend(&scratch, "\x1b[K", 3);
+    int msglen = strlen(E.statusmsg);
+    if (msglen > E.screencols) msglen = E.screencols;
+    if (msglen && time(NULL) - E.status_time < 5)
+        abAppend(&scratch, E.statusmsg, msglen);
+    editorEmitLine(ab, E.screenrows + 2, scratch.b, scratch.len, emit_color);
+    abFree(&scratch);
+}
+
+// Frame buffers persist across refreshes: each frame assembles into the
+// one the previous frame didn't use, so steady-state drawing allocates
+// nothing once capacity settles at the high-water mark
+static struct abuf frame_bufs[2] = {ABUF_INIT, ABUF_INIT};
+static int frame_cur = 0;
+
+void editorRefreshScreen() {
+    long long t0 = perfNow();
+    editorLoaderPoll();
+    editorSavePoll();
+    followPoll();
+    editorScroll();
+    frame_cur ^= 1;
+    struct abuf *ab = &frame_bufs[frame_cur];
+    ab -> len = 0;
+
+#if KILO_SYNC_UPDATE
+    abAppend(ab, "\x1b[?2026h", 8); // Begin synchronized update
+#endif
+    abAppend(ab, "\x1b[?25l", 6); // Hide cursor
+
+    // Each draw function emits only the terminal rows that changed
+    // since the last frame (see editorEmitLine)
+    editorDrawRows(ab);
+    editorDrawStatusBar(ab);
+    editorDrawMessageBar(ab);
+
+    // Move cursor to updated position
+    char buf[32];
+    snprintf(buf, sizeof(buf), "\x1b[%d;%dH", (E.cy - E.rowoff) + 1, (E.rx - E.coloff) + 1);
+    abAppend(ab, buf, strlen(buf));
+
+    abAppend(ab, "\x1b[?25h", 6); // Show cursor again
+#if KILO_SYNC_UPDATE
+    abAppend(ab, "\x1b[?2026l", 8); // End synchronized update
+#endif
+
+    if (termWriteAll(ab -> b, ab -> len) == -1) die("write");
+
+    long long now = perfNow();
+    perfRecord(PERF_REFRESH, now - t0);
+    // First frame after a keystroke: that's the latency operators feel
+    if (perf_key_ns) {
+        perfRecord(PERF_K2F, now - perf_key_ns);
+        perf_key_ns = 0;
+    }
+}
+
+void editorSetStatusMessage(const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(E.statusmsg, sizeof(E.statusmsg), fmt, ap);
+    va_end(ap);
+    E.status_time = time(NULL);
+}
+
+
+// * INPUT ----------
+// editorPrompt: Prompt user for input (used for save-as, search, etc.)
+// editorMoveCursor: Handle cursor movement for arrow keys
+// editorProcessKeypress: Main input handler (dispatches on key pressed)
+
+char *editorPrompt(char *prompt, void (*callback)(char *, int)) {
+    size_t bufsize = 128;
+    char *buf = malloc(bufsize);
+    size_t buflen = 0;
+    buf[0] = '\0';
+
+    while (1) {
+        editorSetStatusMessage(prompt, buf);
+        if (!inputPending()) editorRefreshScreen();
+
+        int c = editorReadKey();
+        // Handle backspace/delete
+        if (c == DEL_KEY || c == CTRL_KEY('h') || c == BACKSPACE) {
+            if (buflen != 0) buf[--buflen] = '\0';
+        } else if (c == '\x1b') {
+            // Cancel input
+            editorSetStatusMessage("");
+            if (callback) callback(buf, c);
+            free(buf);
+            return NULL;
+        } else if (c == '\r') {
+            // Enter: accept input if not empty
+            if (buflen != 0) {
+                editorSetStatusMessage("");
+                if (callback) callback(buf, c);
+                return buf;
+            }
+        } else if (!iscntrl(c) && c < 128) {
+            // Append normal character
+            if (buflen == bufsize - 1) {
+                bufsize *= 2;
+                buf = realloc(buf, bufsize);
+            }
+            buf[buflen++] = c;
+            buf[buflen] = '\0';
+        }
+        if (callback) callback(buf, c);
+    }
+}
+
+void editorMoveCursor(int key) {
+    erow *row = (E.cy >= E.numrows) ? NULL : editorRowAt(E.cy);
+    switch (key) {
+        case ARROW_LEFT:
+            if (E.cx != 0) {
+                E.cx--;
+                // Land on the lead byte of a multi-byte sequence
+                if (row && !editorRowAscii(row))
+                    while (E.cx > 0 && utf8IsCont((unsigned char)row -> chars[E.cx]))
+                        E.cx--;
+            } else if (E.cy > 0) {
+                E.cy--;
+                E.cx = editorRowAt(E.cy) -> size;
+            }
+        break;
+        case ARROW_RIGHT:
+            if (row && E.cx < row -> size) {
+                E.cx++;
+                // Step over the whole sequence, not one byte of it
+                if (!editorRowAscii(row))
+                    while (E.cx < row -> size && utf8IsCont((unsigned char)row -> chars[E.cx]))
+                        E.cx++;
+            } else if (row && E.cx == row -> size) {
+                E.cy++;
+                E.cx = 0;
+            }
+            break;
+        case ARROW_UP:
+            if (E.cy != 0) {
+                E.cy--;
+            }
+            break;
+        case ARROW_DOWN:
+            if (E.cy < E.numrows) {
+                E.cy++;
+            }
+            break;
+    }
+
+    row = (E.cy >= E.numrows) ? NULL : editorRowAt(E.cy);
+    int rowlen = row ? row -> size : 0;
+    if (E.cx > rowlen) {
+        E.cx = rowlen;
+    }
+}
+
+// editorMoveWord: Jump to the previous/next word boundary (Ctrl-arrows),
+// crossing a line end the way a plain arrow would
+void editorMoveWord(int dir) {
+    if (E.cy >= E.numrows) {
+        if (dir < 0 && E.cy > 0) {
+            E.cy--;
+            E.cx = editorRowAt(E.cy) -> size;
+        }
+        return;
+    }
+    erow *row = editorRowAt(E.cy);
+    if (dir > 0) {
+        if (E.cx >= row -> size) {
+            if (E.cy + 1 > E.numrows) return;
+            E.cy++;
+            E.cx = 0;
+            return;
+        }
+        int i = E.cx;
+        while (i < row -> size && !is_separator(row -> chars[i])) i++;
+        while (i < row -> size && is_separator(row -> chars[i])) i++;
+        E.cx = i;
+    } else {
+        if (E.cx == 0) {
+            if (E.cy == 0) return;
+            E.cy--;
+            E.cx = editorRowAt(E.cy) -> size;
+            return;
+        }
+        int i = E.cx;
+        while (i > 0 && is_separator(row -> chars[i - 1])) i--;
+        while (i > 0 && !is_separator(row -> chars[i - 1])) i--;
+        E.cx = i;
+    }
+}
+
+// editorMoveParagraph: Jump to the previous/next blank row (Ctrl-Up/Down)
+void editorMoveParagraph(int dir) {
+    int cy = E.cy + dir;
+    while (cy > 0 && cy < E.numrows && editorRowAt(cy) -> size != 0)
+        cy += dir;
+    if (cy < 0) cy = 0;
+    if (cy > E.numrows) cy = E.numrows;
+    E.cy = cy;
+    E.cx = 0;
+}
+
+
+// editorPaste: Collect everything between the bracketed-paste markers
+// and hand it to the bulk insertion path in one go
+void editorPaste() {
+    static const char terminator[] = "\x1b[201~";
+    struct abuf text = ABUF_INIT;
+    int matched = 0;
+    while (1) {
+        int c = editorReadByte();
+        if (c == terminator[matched]) {
+            matched++;
+            if (terminator[matched] == '\0') break;
+        } else {
+            // Flush a partial terminator match back into the text
+            if (matched) {
+                abAppend(&text, terminator, matched);
+                matched = 0;
+            }
+            if (c == terminator[0]) {
+                matched = 1;
+            } else {
+                char byte = c;
+                abAppend(&text, &byte, 1);
+            }
+        }
+    }
+    editorInsertText(text.b, text.len);
+    abFree(&text);
+    editorSetStatusMessage("Pasted %d bytes", text.len);
+}
+
+// editorGoto: Jump to a line ("123"), a file percentage ("50%"), or a
+// byte offset ("@123456"). Offset lookups go through the byte index, so
+// they are O(log n) even on multi-million-line files.
+void editorGoto() {
+    char *resp = editorPrompt("Goto line/%%/@byte: %s (ESC to cancel)", NULL);
+    if (resp == NULL) return;
+    size_t rlen = strlen(resp);
+    if (resp[0] == '@') {
+        long long off = atoll(resp + 1);
+        long long total = byteIndexPrefix(E.numrows);
+        if (off < 0) off = 0;
+        if (off > total) off = total;
+        E.cy = byteIndexFindRow(off);
+        E.cx = (int)(off - byteIndexPrefix(E.cy));
+        if (E.cy < E.numrows && E.cx > editorRowAt(E.cy) -> size)
+            E.cx = editorRowAt(E.cy) -> size;
+    } else if (rlen && resp[rlen - 1] == '%') {
+        long long pct = atoll(resp);
+        if (pct < 0) pct = 0;
+        if (pct > 100) pct = 100;
+        E.cy = (int)((long long)E.numrows * pct / 100);
+        if (E.cy >= E.numrows) E.cy = E.numrows ? E.numrows - 1 : 0;
+        E.cx = 0;
+    } else {
+        long long line = atoll(resp) - 1;
+        if (line < 0) line = 0;
+        if (line >= E.numrows) line = E.numrows ? E.numrows - 1 : 0;
+        E.cy = (int)line;
+        E.cx = 0;
+    }
+    free(resp);
+}
+
+void editorProcessKeypress() {
+    static int quit_times = KILO_QUIT_TIMES;
+    int c = editorReadKey();
+    // Follow mode is read-only: allow only keys that navigate or run
+    // commands and swallow everything else, so no unlisted key (tab,
+    // undo/redo, plain typing) can reach an editing path
+    if (FW.active) {
+        switch (c) {
+            case ARROW_UP:
+            case ARROW_DOWN:
+            case ARROW_LEFT:
+            case ARROW_RIGHT:
+            case CTRL_ARROW_UP:
+            case CTRL_ARROW_DOWN:
+            case CTRL_ARROW_LEFT:
+            case CTRL_ARROW_RIGHT:
+            case PAGE_UP:
+            case PAGE_DOWN:
+            case HOME_KEY:
+            case END_KEY:
+            case CTRL_KEY('q'):  // quit
+            case CTRL_KEY('t'):  // stop following
+            case CTRL_KEY('f'):  // find
+            case CTRL_KEY('r'):  // regex find
+            case CTRL_KEY('g'):  // goto
+            case CTRL_KEY('b'):  // next buffer
+            case CTRL_KEY('o'):  // open buffer
+            case CTRL_KEY('k'):  // set mark
+            case CTRL_KEY('c'):  // copy region (doesn't mutate)
+            case CTRL_KEY('p'):  // perf digest
+            case CTRL_KEY('l'):
+            case '\x1b':
+                break;
+            default:
+                editorSetStatusMessage("Read-only while following (Ctrl-T to stop)");
+                return;
+        }
+    }
+    switch (c) {
+        case '\r':
+            editorInsertNewLine();
+            break;
+
+        case CTRL_KEY('q'):
+            if (SV.active) {
+                // Don't abandon an in-flight save; finish it first
+                editorSaveFinish();
+            }
+            if (E.dirty_flag && quit_times > 0) {
+                editorSetStatusMessage("WARNING! File has unsaved changes. ""Press Ctrl-Q %d more time(s) to quit.", quit_times);
+                quit_times--;
+                return;
+            }
+            perfDump();
+            sessionSave();
+            if (termWriteAll("\x1b[2J\x1b[H", 7) == -1)
+                perror("write");
+            exit(0);
+            break;
+
+        case CTRL_KEY('s'):
+            editorSave();
+            break;
+        
+        case HOME_KEY:
+            E.cx = 0;
+            break;
+        case END_KEY:
+            if (E.cy < E.numrows) 
+                E.cx = editorRowAt(E.cy) -> size;
+            break;    
+        
+        case CTRL_KEY('f'):
+            editorFind();
+            break;
+
+        case CTRL_KEY('r'):
+            editorFindRegex();
+            break;
+
+        case CTRL_KEY('o'):
+            editorBufferOpen();
+            break;
+        case CTRL_KEY('b'):
+            editorBufferNext();
+            break;
+
+        case BACKSPACE:
+        case CTRL_KEY('h'):
+        case DEL_KEY:
+            if (c == DEL_KEY) editorMoveCursor(ARROW_RIGHT);
+            editorDelChar();
+            break;
+
+        case PAGE_UP:
+        case PAGE_DOWN: {
+            // Direct index arithmetic instead of one editorMoveCursor()
+            // call per screen row; the batch's single refresh scrolls
+            int jump = E.screenrows;
+            if (c == PAGE_UP) {
+                E.cy -= jump;
+                E.rowoff -= jump;
+                if (E.cy < 0) E.cy = 0;
+                if (E.rowoff < 0) E.rowoff = 0;
+            } else {
+                E.cy += jump;
+                E.rowoff += jump;
+                if (E.cy > E.numrows) E.cy = E.numrows;
+                if (E.rowoff > E.numrows - 1) E.rowoff = E.numrows ? E.numrows - 1 : 0;
+            }
+            int rowlen = (E.cy < E.numrows) ? editorRowAt(E.cy) -> size : 0;
+            if (E.cx > rowlen) E.cx = rowlen;
+        }
+            break;
+        case ARROW_UP:
+        case ARROW_DOWN:
+        case ARROW_LEFT:
+        case ARROW_RIGHT:
+            editorMoveCursor(c);
+            break;
+
+        case CTRL_ARROW_LEFT:
+            editorMoveWord(-1);
+            break;
+        case CTRL_ARROW_RIGHT:
+            editorMoveWord(1);
+            break;
+        case CTRL_ARROW_UP:
+            editorMoveParagraph(-1);
+            break;
+        case CTRL_ARROW_DOWN:
+            editorMoveParagraph(1);
+            break;
+
+        case CTRL_KEY('z'):
+            editorUndo();
+            break;
+        case CTRL_KEY('y'):
+            editorRedo();
+            break;
+
+        case PASTE_START:
+            editorPaste();
+            break;
+        case PASTE_END:
+            break; // stray terminator, ignore
+
+        case CTRL_KEY('p'):
+            perf_visible = !perf_visible;
+            break;
+
+        case CTRL_KEY('g'):
+            editorGoto();
+            break;
+
+        case CTRL_KEY('k'):
+            MK.active = !MK.active;
+            MK.cy = E.cy;
+            MK.cx = E.cx;
+            editorSetStatusMessage(MK.active ? "Mark set" : "Mark cleared");
+            break;
+        case CTRL_KEY('c'):
+            editorRegionCopy();
+            break;
+        case CTRL_KEY('w'):
+            editorRegionCut();
+            break;
+        case CTRL_KEY('v'):
+            editorRegionPaste();
+            break;
+
+        case CTRL_KEY('t'):
+            if (FW.active) {
+                followStop();
+                editorSetStatusMessage("Follow mode off");
+            } else {
+                followStart();
+            }
+            break;
+
+        case CTRL_KEY('l'):
+        case '\x1b':
+            break;
+        
+        default:
+            editorInsertChar(c);
+            break;
+    }
+
+    quit_times = KILO_QUIT_TIMES;
+}
+
+// * INIT ----------
+// initEditor: Initialize editor state
+// main: Entry point, main loop
+
+void initEditor() {
+    E.cx = 0;
+    E.cy = 0;
+    E.rx = 0;
+    E.rowoff = 0;
+    E.coloff = 0;
+    E.numrows = 0;
+    E.row = NULL;
+    E.rowcap = 0;
+    E.row_gap = 0;
+    E.dirty_flag = 0;
+    E.filename = NULL;
+    E.statusmsg[0] = '\0';
+    E.status_time = 0;
+    E.mapped = NULL;
+    E.mapped_len = 0;
+    E.slabs = NULL;
+    E.journal = NULL;
+    E.journal_path = NULL;
+    E.syntax = NULL;
+
+    buffers[0].in_use = 1; // the initial buffer lives in slot 0
+
+    if (getWindowSize(&E.screenrows, &E.screencols) == -1) die("getWindowSize");
+    E.screenrows -= 2;
+    editorShadowResize(E.screenrows + 2);
+}
+
+int main(int argc, char *argv[]) {
+    enableRawMode();
+    initEditor();
+
+    if (argc >= 2) {
+        editorOpen(argv[1]);
+        sessionRestore();
+    }
+
+    editorSetStatusMessage("HELP: Ctrl-S = save | Ctrl-Q = quit | Ctrl-F = find | Ctrl-O = open | Ctrl-B = next buffer");
+
+    while (1) {
+        editorRefreshScreen();
+        editorProcessKeypress();
+        // Coalesce redraws: drain every key already buffered (e.g. a
+        // paste) before paying for another refresh
+        while (inputPending()) editorProcessKeypress();
+    }
+
+    return 0;
+}